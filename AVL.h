@@ -0,0 +1,683 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm> // Для std::max
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "Augment.h"
+#include "BatchSearch.h"
+#include "ForkJoin.h"
+#include "FrozenTree.h"
+#include "NodePool.h"
+#include "TreeIterator.h"
+#include "TreeStats.h"
+#include "TreeVisit.h"
+
+namespace avl {
+
+class Node : public PoolAllocated<Node> {
+public:
+    int value;      // Значение узла
+    int copies;     // Кратность значения; больше 1 только после insertCounted
+    Node* left;     // Указатель на левого потомка
+    Node* right;    // Указатель на правого потомка
+    int height;     // Высота узла
+    SubtreeStats stats; // Размер, сумма, минимум и максимум поддерева
+
+    // Конструктор
+    Node(int val) : value(val), copies(1), left(nullptr), right(nullptr), height(1), stats(val) {}
+
+    // Метод для нахождения высоты узла
+    int getHeight() {
+        return height;
+    }
+
+    static const SubtreeStats& statsOf(const Node* node) {
+        static const SubtreeStats empty;
+        return node ? node->stats : empty;
+    }
+
+    // Метод для обновления высоты и сводки узла
+    void update() {
+        height = 1 + std::max(left ? left->getHeight() : 0, right ? right->getHeight() : 0);
+        updateStats();
+    }
+
+    void updateStats() {
+        stats = SubtreeStats::combine(statsOf(left), value, copies, statsOf(right));
+    }
+
+    // Метод для получения баланса узла
+    int getBalance() {
+        return (left ? left->getHeight() : 0) - (right ? right->getHeight() : 0);
+    }
+
+    // Правый поворот
+    Node* rightRotate() {
+        treestats::count(treestats::ROTATIONS);
+        Node* newRoot = left; // Новый корень — левый потомок
+        Node* temp = newRoot->right; // Сохраняем правое поддерево нового корня
+
+        newRoot->right = this; // Перемещаем текущий узел вправо
+        left = temp; // Перемещаем правое поддерево нового корня в левое поддерево текущего узла
+
+        // Обновляем высоты и сводки
+        update();
+        newRoot->update();
+
+        return newRoot; // Возвращаем новый корень
+    }
+
+    // Левый поворот
+    Node* leftRotate() {
+        treestats::count(treestats::ROTATIONS);
+        Node* newRoot = right; // Новый корень — правый потомок
+        Node* temp = newRoot->left; // Сохраняем левое поддерево нового корня
+
+        newRoot->left = this; // Перемещаем текущий узел влево
+        right = temp; // Перемещаем левое поддерево нового корня в правое поддерево текущего узла
+
+        // Обновляем высоты и сводки
+        update();
+        newRoot->update();
+
+        return newRoot; // Возвращаем новый корень
+    }
+
+    // Балансировка узла после изменения одного из поддеревьев.
+    // Возвращает новый корень поддерева
+    Node* rebalance() {
+        update();
+        int balance = getBalance();
+
+        if (balance > 1) {
+            // Левый правый случай сводим к левому левому
+            if (left->getBalance() < 0) {
+                left = left->leftRotate();
+            }
+            return rightRotate();
+        }
+
+        if (balance < -1) {
+            // Правый левый случай сводим к правому правому
+            if (right->getBalance() > 0) {
+                right = right->rightRotate();
+            }
+            return leftRotate();
+        }
+
+        return this;
+    }
+
+    // Высота AVL-дерева не больше 1.44 * log2(n + 2), так что стека пути
+    // на 128 уровней хватает для любого дерева, помещающегося в память
+    static const int kMaxDepth = 128;
+
+    // Метод для вставки значения в AVL-дерево (без рекурсии)
+    Node* insert(int val) {
+        return insertValue(val, false);
+    }
+
+    // Вставка в режиме мультимножества: если значение уже есть, у его узла
+    // растёт кратность — ни выделения памяти, ни поворотов, только сводки
+    // на пути. Повторы горячих ключей (zipfian) не раздувают дерево
+    Node* insertCounted(int val) {
+        return insertValue(val, true);
+    }
+
+    // Путь запоминается как ссылки на указатели потомков, чтобы после поворота
+    // записать новый корень поддерева прямо в родителя
+    Node* insertValue(int val, bool counted) {
+        Node** path[kMaxDepth];
+        int depth = 0;
+
+        Node* root = this;
+        Node** link = &root;
+        while (*link) {
+            Node* node = *link;
+            if (counted && node->value == val) {
+                ++node->copies;
+                node->updateStats();
+                while (depth > 0) {
+                    (*path[--depth])->updateStats();
+                }
+                return root;
+            }
+            path[depth++] = link;
+            // Равные значения идут в правое поддерево
+            link = val < node->value ? &node->left : &node->right;
+        }
+        *link = new Node(val);
+
+        // Поднимаемся к корню, обновляем высоты и балансируем
+        while (depth > 0) {
+            Node** l = path[--depth];
+            int oldHeight = (*l)->height;
+            *l = (*l)->rebalance();
+            if ((*l)->height == oldHeight) {
+                break; // Высота поддерева не изменилась — выше поворотов не будет
+            }
+        }
+        // Сводки выше меняются всегда: добавилось значение
+        while (depth > 0) {
+            (*path[--depth])->updateStats();
+        }
+        return root;
+    }
+
+    // Число значений, меньших val
+    int rank(int val) const {
+        return rankOf(this, val);
+    }
+
+    // Сколько раз встречается val (с учётом кратностей)
+    int count(int val) const {
+        return countOf(this, val);
+    }
+
+    // Узел с k-м по возрастанию значением (k с нуля) или nullptr
+    Node* select(int k) {
+        return selectNode(this, k);
+    }
+
+    // Число, сумма, минимум и максимум значений из [lo, hi]
+    SubtreeStats rangeAggregate(int lo, int hi) const {
+        return aggregateRange(this, lo, hi);
+    }
+
+    // Метод для поиска значения в AVL-дереве
+    Node* search(int val) {
+        Node* current = this;
+        int descended = 0; // Для TreeStats.h; без TREE_STATS компилятор его выбросит
+        while (current && current->value != val) {
+            current = val < current->value ? current->left : current->right;
+            ++descended;
+        }
+        treestats::searched(descended, current != nullptr);
+        return current;
+    }
+
+    // Пакетный поиск: results[i] — найдено ли keys[i]; поиски идут вперемешку
+    // с предвыборкой, чтобы промахи кэша перекрывались
+    void searchBatch(const int* keys, size_t n, bool* results) const {
+        searchInterleaved(this, keys, n, results);
+    }
+
+    // Метод для нахождения минимального узла в дереве
+    Node* findMin() {
+        Node* current = this;
+        while (current && current->left) {
+            current = current->left; // Идем в левое поддерево
+        }
+        return current; // Возвращаем узел с минимальным значением
+    }
+
+    // Метод для удаления одного вхождения значения из AVL-дерева (без рекурсии).
+    // У кратного значения уменьшается кратность, узел остаётся на месте
+    Node* remove(int val) {
+        Node** path[kMaxDepth];
+        int depth = 0;
+
+        Node* root = this;
+        Node** link = &root;
+        while (*link && (*link)->value != val) {
+            path[depth++] = link;
+            Node* node = *link;
+            link = val < node->value ? &node->left : &node->right;
+        }
+
+        Node* target = *link;
+        if (!target) {
+            return root; // Значение не найдено
+        }
+
+        if (target->copies > 1) {
+            --target->copies;
+            target->updateStats();
+            while (depth > 0) {
+                (*path[--depth])->updateStats();
+            }
+            return root;
+        }
+
+        if (target->left && target->right) {
+            // Узел имеет двух потомков: переносим минимум правого поддерева
+            path[depth++] = link;
+            Node** minLink = &target->right;
+            while ((*minLink)->left) {
+                path[depth++] = minLink;
+                minLink = &(*minLink)->left;
+            }
+            Node* minNode = *minLink;
+            target->value = minNode->value;
+            target->copies = minNode->copies;
+            *minLink = minNode->right;
+            delete minNode;
+        }
+        else {
+            // Не больше одного потомка: он занимает место узла
+            *link = target->left ? target->left : target->right;
+            delete target;
+        }
+
+        while (depth > 0) {
+            Node** l = path[--depth];
+            int oldHeight = (*l)->height;
+            *l = (*l)->rebalance();
+            if ((*l)->height == oldHeight) {
+                break;
+            }
+        }
+        while (depth > 0) {
+            (*path[--depth])->updateStats();
+        }
+        return root;
+    }
+
+    // Балансировка после пакетной операции: поддеревья могли измениться сильно,
+    // поэтому перекос больше двух уровней исправляем перестройкой поддерева
+    Node* rebalanceBatch() {
+        update();
+        int balance = getBalance();
+        if (balance >= -2 && balance <= 2) {
+            return rebalance();
+        }
+        return rebuild(this);
+    }
+
+    // Перестраивает поддерево в идеально сбалансированное, переиспользуя узлы
+    static Node* rebuild(Node* root) {
+        std::vector<Node*> nodes;
+        std::vector<Node*> stack;
+        Node* current = root;
+        while (current || !stack.empty()) {
+            while (current) {
+                stack.push_back(current);
+                current = current->left;
+            }
+            current = stack.back();
+            stack.pop_back();
+            nodes.push_back(current);
+            current = current->right;
+        }
+        return linkBalanced(nodes.data(), nodes.size());
+    }
+
+    static Node* linkBalanced(Node** nodes, size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        size_t mid = n / 2;
+        Node* node = nodes[mid];
+        node->left = linkBalanced(nodes, mid);
+        node->right = linkBalanced(nodes + mid + 1, n - mid - 1);
+        node->update();
+        return node;
+    }
+
+    // Пакетная вставка: ключи сортируются и раздаются по дереву за один спуск,
+    // на месте пустого потомка сразу строится поддерево из попавших туда ключей,
+    // а балансировка откладывается до возврата — по разу на узел пути
+    static Node* insertBatch(Node* root, std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        return insertSorted(root, keys.data(), keys.data() + keys.size());
+    }
+
+    // Пакетное удаление: по одному вхождению на каждый ключ пакета
+    static Node* removeBatch(Node* root, std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        std::vector<std::pair<int, int>> counted; // (значение, сколько вхождений ещё удалить)
+        for (int k : keys) {
+            if (!counted.empty() && counted.back().first == k) {
+                ++counted.back().second;
+            }
+            else {
+                counted.push_back(std::make_pair(k, 1));
+            }
+        }
+        return removeSorted(root, counted.data(), counted.data() + counted.size());
+    }
+
+    static Node* insertSorted(Node* node, const int* first, const int* last) {
+        if (first == last) {
+            return node;
+        }
+        if (!node) {
+            return buildBalanced(first, static_cast<size_t>(last - first));
+        }
+        const int* mid = std::lower_bound(first, last, node->value); // Равные — вправо
+        node->left = insertSorted(node->left, first, mid);
+        node->right = insertSorted(node->right, mid, last);
+        return node->rebalanceBatch();
+    }
+
+    static Node* removeSorted(Node* node, std::pair<int, int>* first, std::pair<int, int>* last) {
+        if (!node || first == last) {
+            return node;
+        }
+        std::pair<int, int>* mid = std::lower_bound(first, last, node->value,
+            [](const std::pair<int, int>& p, int v) { return p.first < v; });
+        std::pair<int, int>* equal = (mid != last && mid->first == node->value) ? mid : nullptr;
+        // Кратный узел сразу забирает до copies вхождений
+        int taken = equal ? std::min(equal->second, node->copies) : 0;
+        if (equal) equal->second -= taken;
+        node->copies -= taken;
+        bool removeSelf = taken > 0 && node->copies == 0;
+
+        // После поворотов равные значения бывают в обоих поддеревьях:
+        // остаток счётчика, не найденный справа, ищем слева
+        node->right = removeSorted(node->right, mid, last);
+        node->left = removeSorted(node->left, first, equal ? mid + 1 : mid);
+
+        if (removeSelf) {
+            if (!node->left || !node->right) {
+                Node* child = node->left ? node->left : node->right;
+                delete node;
+                return child;
+            }
+            Node* first = nullptr;
+            node->right = removeFirst(node->right, first);
+            node->value = first->value;
+            node->copies = first->copies;
+            delete first;
+        }
+        return node->rebalanceBatch();
+    }
+
+    // split и join (Blelloch, Ferizovic, Sun, 2016). join подвешивает два дерева
+    // к среднему узлу: спускается по краю более высокого до поддерева высоты
+    // другого ± 1 и балансирует на обратном пути — O(|h(l) - h(r)| + 1).
+    // На них построены объединение, пересечение и разность за O(m log(n / m + 1)),
+    // m <= n: две половины рекурсии независимы и идут параллельно (ForkJoin.h).
+    // Операции над множествами считают, что ключи в каждом дереве не повторяются.
+
+    // Дерево из ключей left, key и right; все ключи left не больше key, right — не меньше
+    static Node* join(Node* left, int key, Node* right) {
+        return joinNodes(left, new Node(key), right);
+    }
+
+    // Разрезает дерево: в left ключи меньше key, в right — больше.
+    // Узел с ключом key удаляется; возвращает, был ли он
+    static bool split(Node* root, int key, Node*& left, Node*& right) {
+        Node* found = splitNodes(root, key, left, right);
+        delete found;
+        return found != nullptr;
+    }
+
+    // Объединение, пересечение и разность a \ b. Деревья-аргументы
+    // расходуются: их узлы переходят в результат или удаляются
+    static Node* unionOf(Node* a, Node* b) {
+        return setOperation(kUnion, a, b);
+    }
+
+    static Node* intersectionOf(Node* a, Node* b) {
+        return setOperation(kIntersection, a, b);
+    }
+
+    static Node* differenceOf(Node* a, Node* b) {
+        return setOperation(kDifference, a, b);
+    }
+
+    static int heightOf(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    static int sizeOf(const Node* node) {
+        return node ? node->stats.size : 0;
+    }
+
+    static Node* joinNodes(Node* left, Node* middle, Node* right) {
+        if (heightOf(left) > heightOf(right) + 1) {
+            left->right = joinNodes(left->right, middle, right);
+            return left->rebalance();
+        }
+        if (heightOf(right) > heightOf(left) + 1) {
+            right->left = joinNodes(left, middle, right->left);
+            return right->rebalance();
+        }
+        middle->left = left;
+        middle->right = right;
+        middle->update();
+        return middle;
+    }
+
+    // join без среднего ключа: средним становится наибольший узел left
+    static Node* joinNodes(Node* left, Node* right) {
+        if (!left) {
+            return right;
+        }
+        Node* last = nullptr;
+        left = removeLast(left, last);
+        return joinNodes(left, last, right);
+    }
+
+    static Node* removeLast(Node* node, Node*& last) {
+        if (!node->right) {
+            last = node;
+            return node->left;
+        }
+        node->right = removeLast(node->right, last);
+        return node->rebalance();
+    }
+
+    // Отцепляет наименьший узел в first
+    static Node* removeFirst(Node* node, Node*& first) {
+        if (!node->left) {
+            first = node;
+            return node->right;
+        }
+        node->left = removeFirst(node->left, first);
+        return node->rebalance();
+    }
+
+    // Возвращает отцепленный узел с ключом key или nullptr
+    static Node* splitNodes(Node* node, int key, Node*& left, Node*& right) {
+        if (!node) {
+            left = right = nullptr;
+            return nullptr;
+        }
+        Node* l = node->left;
+        Node* r = node->right;
+        if (key == node->value) {
+            left = l;
+            right = r;
+            node->left = node->right = nullptr;
+            node->update();
+            return node;
+        }
+        if (key < node->value) {
+            Node* found = splitNodes(l, key, left, l);
+            right = joinNodes(l, node, r);
+            return found;
+        }
+        Node* found = splitNodes(r, key, r, right);
+        left = joinNodes(l, node, r);
+        return found;
+    }
+
+    enum SetOperation { kUnion, kIntersection, kDifference };
+
+    // Лишние узлы собираются в dropped и удаляются в конце в вызывающем потоке:
+    // так ветви не трогают общий пул узлов
+    static Node* setOperation(SetOperation op, Node* a, Node* b) {
+        std::vector<Node*> dropped;
+        Node* result = setOperation(op, a, b, forkBudget(), dropped);
+        for (Node* node : dropped) destroy(node);
+        return result;
+    }
+
+    // Корень b делит a пополам, половины обрабатываются независимо
+    static Node* setOperation(SetOperation op, Node* a, Node* b, int budget, std::vector<Node*>& dropped) {
+        if (!a || !b) {
+            Node* kept = op == kUnion ? (a ? a : b) : op == kDifference ? a : nullptr;
+            if (a && a != kept) dropped.push_back(a);
+            if (b && b != kept) dropped.push_back(b);
+            return kept;
+        }
+        bool fork = budget > 0 && sizeOf(a) + sizeOf(b) > kForkGrain;
+        Node* bLeft = b->left;
+        Node* bRight = b->right;
+        b->left = b->right = nullptr;
+        Node* aLeft;
+        Node* aRight;
+        Node* found = splitNodes(a, b->value, aLeft, aRight);
+        if (found) dropped.push_back(found);
+
+        Node* left;
+        Node* right;
+        std::vector<Node*> droppedLeft;
+        forkJoin(fork,
+            [&]() { left = setOperation(op, aLeft, bLeft, budget - 1, droppedLeft); },
+            [&]() { right = setOperation(op, aRight, bRight, budget - 1, dropped); });
+        dropped.insert(dropped.end(), droppedLeft.begin(), droppedLeft.end());
+
+        if (op == kUnion || (op == kIntersection && found)) {
+            return joinNodes(left, b, right);
+        }
+        dropped.push_back(b);
+        return joinNodes(left, right);
+    }
+
+    // Построение из отсортированного диапазона за O(n) без поворотов:
+    // половины диапазона отличаются не больше чем на 1, так что дерево сразу сбалансировано
+    template <class It>
+    static Node* buildFromSorted(It first, It last) {
+        return buildBalanced(first, static_cast<size_t>(std::distance(first, last)));
+    }
+
+    // Строим поддерево из следующих n значений it
+    template <class It>
+    static Node* buildBalanced(It& it, size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        Node* leftTree = buildBalanced(it, n / 2); // Левая половина
+        Node* node = new Node(*it); // Середина — корень поддерева
+        ++it;
+        node->left = leftTree;
+        node->right = buildBalanced(it, n - n / 2 - 1); // Правая половина
+        node->update();
+        return node;
+    }
+
+    // Неизменяемый снимок для поиска без указателей: один симметричный обход
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        sorted.reserve(stats.size);
+        inorder([&sorted](const Node* node) { sorted.insert(sorted.end(), node->copies, node->value); });
+        return FrozenTree(sorted);
+    }
+
+    // Итераторы по возрастанию значений (Node — корень дерева); кратный узел —
+    // один шаг итератора, его кратность — node()->copies
+    typedef PathIterator<Node> Iterator;
+
+    Iterator begin() {
+        return Iterator::first(this);
+    }
+
+    Iterator end() {
+        return Iterator(this);
+    }
+
+    // Первый узел со значением >= val
+    Iterator lowerBound(int val) {
+        return Iterator::lowerBound(this, val);
+    }
+
+    // Первый узел со значением > val
+    Iterator upperBound(int val) {
+        return Iterator::upperBound(this, val);
+    }
+
+    // Значения из отрезка [lo, hi] по возрастанию
+    IteratorRange<Iterator> range(int lo, int hi) {
+        if (lo > hi) {
+            return IteratorRange<Iterator>(end(), end());
+        }
+        return IteratorRange<Iterator>(lowerBound(lo), upperBound(hi));
+    }
+
+    // Вызывает visit(value) для значений из [lo, hi] по возрастанию,
+    // кратное значение — copies раз
+    template <class F>
+    void scan(int lo, int hi, F visit) {
+        for (Iterator it = lowerBound(lo); it.node() && *it <= hi; ++it) {
+            for (int i = it.node()->copies; i > 0; --i) visit(*it);
+        }
+    }
+
+    // Удаление всего дерева
+    static void destroy(Node* root) {
+        std::vector<Node*> stack;
+        if (root) stack.push_back(root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            if (node->left) stack.push_back(node->left); // Потомков удалим позже
+            if (node->right) stack.push_back(node->right);
+            delete node;
+        }
+    }
+
+    // Метод для вывода узла
+    void print(BufferedWriter& out) const {
+        out << "Node(" << value;
+        if (copies > 1) out << " x" << copies;
+        out << ", height=" << height << ")\n";
+    }
+
+    void print() const {
+        BufferedWriter out(std::cout);
+        print(out);
+    }
+
+    // Префиксный обход (NLR) с посетителем: visit(Node*) для каждого узла
+    template <class Visitor>
+    void preorder(Visitor&& visit) {
+        visitPreorder(this, visit);
+    }
+
+    // Симметричный обход
+    template <class Visitor>
+    void inorder(Visitor&& visit) {
+        visitInorder(this, visit);
+    }
+
+    // Постфиксный обход (LRN)
+    template <class Visitor>
+    void postorder(Visitor&& visit) {
+        visitPostorder(this, visit);
+    }
+
+    // Обход в ширину
+    template <class Visitor>
+    void levelOrder(Visitor&& visit) {
+        visitLevelOrder(this, visit);
+    }
+
+    // Печать обходов через буферизованный вывод
+    void preorder() {
+        BufferedWriter out(std::cout);
+        preorder(PrintVisitor<Node>(out));
+    }
+
+    void inorder() {
+        BufferedWriter out(std::cout);
+        inorder(PrintVisitor<Node>(out));
+    }
+
+    void postorder() {
+        BufferedWriter out(std::cout);
+        postorder(PrintVisitor<Node>(out));
+    }
+
+    void levelOrder() {
+        BufferedWriter out(std::cout);
+        levelOrder(PrintVisitor<Node>(out));
+    }
+};
+
+} // namespace avl
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+
+// Сводка по поддереву: число значений, сумма, минимум и максимум.
+// Хранится в каждом узле и пересчитывается там же, где высота: при вставке,
+// удалении, поворотах и перестройке. По сводкам rank, select и агрегат
+// по отрезку считаются за один-два спуска, O(log n) в сбалансированном дереве.
+// Узел с кратностью copies (режим мультимножества) даёт copies значений
+struct SubtreeStats {
+    int size;
+    long long sum;
+    int min;
+    int max;
+
+    // Пустое поддерево
+    SubtreeStats() : size(0), sum(0), min(INT_MAX), max(INT_MIN) {}
+
+    // Одиночный узел
+    explicit SubtreeStats(int value) : size(1), sum(value), min(value), max(value) {}
+
+    void add(int value, int copies = 1) {
+        size += copies;
+        sum += static_cast<long long>(value) * copies;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void add(const SubtreeStats& other) {
+        size += other.size;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    // Сводка узла по сводкам потомков
+    static SubtreeStats combine(const SubtreeStats& left, int value, int copies, const SubtreeStats& right) {
+        SubtreeStats s = left;
+        s.add(value, copies);
+        s.add(right);
+        return s;
+    }
+};
+
+// Запросы ниже работают с любым узлом, у которого есть value, copies, left, right и stats.
+// nil — фиктивный лист (TNULL у красно-чёрного дерева), для BST и AVL это nullptr
+
+template <class Node>
+int subtreeSize(const Node* node, const Node* nil = nullptr) {
+    return node != nil ? node->stats.size : 0;
+}
+
+// Число значений, меньших key
+template <class Node>
+int rankOf(const Node* root, int key, const Node* nil = nullptr) {
+    int rank = 0;
+    const Node* current = root;
+    while (current != nil) {
+        if (current->value < key) {
+            rank += subtreeSize(current->left, nil) + current->copies;
+            current = current->right;
+        }
+        else {
+            current = current->left;
+        }
+    }
+    return rank;
+}
+
+// Число значений, равных key: разность двух рангов, поэтому учитываются
+// и кратности узлов, и равные значения в разных узлах
+template <class Node>
+int countOf(const Node* root, int key, const Node* nil = nullptr) {
+    int count = 0;
+    const Node* current = root;
+    while (current != nil) {
+        if (current->value <= key) {
+            count += subtreeSize(current->left, nil) + current->copies;
+            current = current->right;
+        }
+        else {
+            current = current->left;
+        }
+    }
+    return count - rankOf(root, key, nil);
+}
+
+// Узел с k-м по возрастанию значением (k с нуля) или nil, если k вне [0, size)
+template <class Node>
+Node* selectNode(Node* root, int k, Node* nil = nullptr) {
+    Node* current = root;
+    while (current != nil) {
+        int leftSize = subtreeSize(current->left, nil);
+        if (k < leftSize) {
+            current = current->left;
+        }
+        else if (k < leftSize + current->copies) {
+            return current;
+        }
+        else {
+            k -= leftSize + current->copies;
+            current = current->right;
+        }
+    }
+    return nil;
+}
+
+// Сводка по значениям из отрезка [lo, hi]. Спускаемся до первого узла внутри
+// отрезка, затем по его левому поддереву вдоль границы lo и по правому вдоль hi:
+// поддеревья, целиком лежащие внутри, берутся готовой сводкой
+template <class Node>
+SubtreeStats aggregateRange(const Node* root, int lo, int hi, const Node* nil = nullptr) {
+    SubtreeStats result;
+    const Node* split = root;
+    while (split != nil && (split->value < lo || split->value > hi)) {
+        split = split->value < lo ? split->right : split->left;
+    }
+    if (split == nil) {
+        return result;
+    }
+    result.add(split->value, split->copies);
+
+    for (const Node* node = split->left; node != nil; ) {
+        if (node->value >= lo) {
+            result.add(node->value, node->copies);
+            if (node->right != nil) result.add(node->right->stats);
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+    for (const Node* node = split->right; node != nil; ) {
+        if (node->value <= hi) {
+            result.add(node->value, node->copies);
+            if (node->left != nil) result.add(node->left->stats);
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+    return result;
+}
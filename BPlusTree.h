@@ -0,0 +1,496 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace bpt {
+
+// B+ дерево с узлами по размеру кэш-линий: ключи узла лежат подряд и
+// сравниваются с искомым разом (AVX2 — по 8, SSE2 — по 4), поэтому на уровень
+// приходится один-два промаха кэша вместо одного промаха на каждый узел пути
+// двоичного дерева. Значения хранятся только в листьях, листья связаны
+// в список для сканирования диапазонов. Равные ключи допускаются.
+//
+// Для AVX2 собирайте с -mavx2 или -march=native; без него используется SSE2,
+// а на других архитектурах — обычный цикл.
+
+const int kLeafSlots = 28;   // Лист: 28 ключей + count + next = 128 байт (две линии)
+const int kInnerSlots = 32;  // Внутренний узел: ключи занимают ровно две линии
+
+// Минимальное заполнение узлов, кроме корня. Слияние двух соседей
+// с минимумом и недобором помещается в один узел
+const int kMinLeafKeys = kLeafSlots / 2;
+const int kMinInnerKeys = kInnerSlots / 2 - 1;
+
+// Число ключей среди первых N ячеек, меньших key. Незанятые ячейки узла
+// заполнены INT_MAX и в счёт не попадают, так что сравниваются все N ячеек
+// без ветвлений по числу ключей. N кратно 4
+template <int N>
+inline int countLess(const int* keys, int key) {
+    static_assert(N % 4 == 0, "число ячеек узла должно быть кратно 4");
+    int n = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i k8 = _mm256_set1_epi32(key);
+    for (; i + 8 <= N; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i less = _mm256_cmpgt_epi32(k8, v); // keys[i] < key
+        n += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    __m128i k4 = _mm_set1_epi32(key);
+    for (; i + 4 <= N; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        __m128i less = _mm_cmpgt_epi32(k4, v);
+        n += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+    }
+#else
+    for (; i < N; ++i) {
+        n += keys[i] < key;
+    }
+#endif
+    return n;
+}
+
+// Общий тип указателя на потомка; лист это или внутренний узел, определяется уровнем
+struct Node {};
+
+struct alignas(64) Leaf : Node {
+    int keys[kLeafSlots];
+    int count;
+    Leaf* next; // Следующий лист по возрастанию ключей
+
+    Leaf() : count(0), next(nullptr) { std::fill(keys, keys + kLeafSlots, INT_MAX); }
+};
+
+// Ключи потомка children[i] лежат в [keys[i - 1], keys[i]]: равные разделителю
+// ключи могут оказаться по обе его стороны
+struct alignas(64) Inner : Node {
+    int keys[kInnerSlots];
+    int count;                        // Число ключей; потомков на один больше
+    Node* children[kInnerSlots + 1];
+
+    Inner() : count(0) { std::fill(keys, keys + kInnerSlots, INT_MAX); }
+};
+
+class BPlusTree {
+public:
+    BPlusTree() : root(nullptr), levels(0), count(0) {}
+
+    ~BPlusTree() {
+        clear();
+    }
+
+    // Вставка; равный ключ встаёт перед уже имеющимися
+    void insert(int key) {
+        if (!root) {
+            root = new Leaf();
+        }
+        Inner* path[kMaxLevels];
+        int slot[kMaxLevels];
+        Node* node = root;
+        for (int l = 0; l < levels; ++l) {
+            Inner* inner = static_cast<Inner*>(node);
+            path[l] = inner;
+            slot[l] = countLess<kInnerSlots>(inner->keys, key);
+            node = inner->children[slot[l]];
+        }
+        ++count;
+
+        Leaf* leaf = static_cast<Leaf*>(node);
+        int pos = countLess<kLeafSlots>(leaf->keys, key);
+        if (leaf->count < kLeafSlots) {
+            std::copy_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            leaf->keys[pos] = key;
+            ++leaf->count;
+            return;
+        }
+
+        // Лист полон: делим пополам, правая половина уходит в новый лист
+        int merged[kLeafSlots + 1];
+        std::copy(leaf->keys, leaf->keys + pos, merged);
+        merged[pos] = key;
+        std::copy(leaf->keys + pos, leaf->keys + kLeafSlots, merged + pos + 1);
+
+        Leaf* right = new Leaf();
+        int leftCount = (kLeafSlots + 1) / 2;
+        right->count = kLeafSlots + 1 - leftCount;
+        std::copy(merged + leftCount, merged + kLeafSlots + 1, right->keys);
+        std::copy(merged, merged + leftCount, leaf->keys);
+        std::fill(leaf->keys + leftCount, leaf->keys + kLeafSlots, INT_MAX);
+        leaf->count = leftCount;
+        right->next = leaf->next;
+        leaf->next = right;
+
+        // Разделитель и новый узел поднимаются вверх, пока не найдётся место
+        int separator = right->keys[0];
+        Node* child = right;
+        for (int l = levels - 1; l >= 0; --l) {
+            Inner* inner = path[l];
+            int i = slot[l];
+            if (inner->count < kInnerSlots) {
+                std::copy_backward(inner->keys + i, inner->keys + inner->count, inner->keys + inner->count + 1);
+                std::copy_backward(inner->children + i + 1, inner->children + inner->count + 1,
+                    inner->children + inner->count + 2);
+                inner->keys[i] = separator;
+                inner->children[i + 1] = child;
+                ++inner->count;
+                return;
+            }
+            splitInner(inner, i, separator, child);
+        }
+
+        Inner* newRoot = new Inner();
+        newRoot->keys[0] = separator;
+        newRoot->count = 1;
+        newRoot->children[0] = root;
+        newRoot->children[1] = child;
+        root = newRoot;
+        ++levels;
+    }
+
+    bool search(int key) const {
+        if (!root) {
+            return false;
+        }
+        Leaf* leaf = findLeaf(key);
+        int pos = countLess<kLeafSlots>(leaf->keys, key);
+        if (pos == leaf->count) {
+            // Все ключи листа меньше: ответ — первый ключ следующего листа
+            leaf = leaf->next;
+            pos = 0;
+            if (!leaf) return false;
+        }
+        return leaf->keys[pos] == key;
+    }
+
+    // Пакетный поиск: results[i] — найдено ли keys[i]. Ключи идут группами
+    // по kGroup, и группа спускается по уровням вместе: пока запрошенные
+    // узлы одного ключа едут из памяти, сравниваются ключи в узлах остальных
+    void searchBatch(const int* keys, size_t n, bool* results) const {
+        const int kGroup = 16;
+        const Node* node[kGroup];
+        for (size_t first = 0; first < n; first += kGroup) {
+            int g = static_cast<int>(std::min(n - first, static_cast<size_t>(kGroup)));
+            const int* group = keys + first;
+            if (!root) {
+                std::fill(results + first, results + first + g, false);
+                continue;
+            }
+            for (int j = 0; j < g; ++j) node[j] = root;
+            for (int l = 0; l < levels; ++l) {
+                for (int j = 0; j < g; ++j) {
+                    const Inner* inner = static_cast<const Inner*>(node[j]);
+                    const Node* child = inner->children[countLess<kInnerSlots>(inner->keys, group[j])];
+                    // Ключи узла — первые две линии
+                    __builtin_prefetch(child);
+                    __builtin_prefetch(reinterpret_cast<const char*>(child) + 64);
+                    node[j] = child;
+                }
+            }
+            for (int j = 0; j < g; ++j) {
+                const Leaf* leaf = static_cast<const Leaf*>(node[j]);
+                int pos = countLess<kLeafSlots>(leaf->keys, group[j]);
+                if (pos == leaf->count) {
+                    leaf = leaf->next;
+                    pos = 0;
+                }
+                results[first + j] = leaf && leaf->keys[pos] == group[j];
+            }
+        }
+    }
+
+    // Удаляет одно вхождение key; false, если ключа нет
+    bool remove(int key) {
+        if (!root || !removeFrom(root, levels, key)) {
+            return false;
+        }
+        --count;
+        if (levels > 0 && static_cast<Inner*>(root)->count == 0) {
+            // У корня остался один потомок — дерево становится ниже
+            Inner* old = static_cast<Inner*>(root);
+            root = old->children[0];
+            delete old;
+            --levels;
+        }
+        else if (levels == 0 && static_cast<Leaf*>(root)->count == 0) {
+            delete static_cast<Leaf*>(root);
+            root = nullptr;
+        }
+        return true;
+    }
+
+    // Вызывает visit(key) для ключей из [lo, hi] по возрастанию: один спуск,
+    // дальше по списку листьев
+    template <class F>
+    void scan(int lo, int hi, F visit) const {
+        if (!root || lo > hi) {
+            return;
+        }
+        Leaf* leaf = findLeaf(lo);
+        int pos = countLess<kLeafSlots>(leaf->keys, lo);
+        for (; leaf; leaf = leaf->next, pos = 0) {
+            for (; pos < leaf->count; ++pos) {
+                if (leaf->keys[pos] > hi) return;
+                visit(leaf->keys[pos]);
+            }
+        }
+    }
+
+    // Число уровней (лист — 1, пустое дерево — 0)
+    int getHeight() const {
+        return root ? levels + 1 : 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    void clear() {
+        if (root) {
+            destroy(root, levels);
+        }
+        root = nullptr;
+        levels = 0;
+        count = 0;
+    }
+
+    // Заменяет содержимое деревом из отсортированного диапазона за O(n):
+    // ключи поровну раскладываются по листьям, затем уровни строятся снизу вверх
+    template <class It>
+    void buildFromSorted(It first, It last) {
+        clear();
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if (n == 0) {
+            return;
+        }
+        count = n;
+
+        std::vector<Node*> nodes;
+        std::vector<int> mins; // Наименьший ключ каждого поддерева — разделитель слева от него
+        size_t leaves = (n + kLeafSlots - 1) / kLeafSlots;
+        Leaf* previous = nullptr;
+        for (size_t j = 0; j < leaves; ++j) {
+            Leaf* leaf = new Leaf();
+            leaf->count = static_cast<int>(n * (j + 1) / leaves - n * j / leaves);
+            for (int k = 0; k < leaf->count; ++k, ++first) {
+                leaf->keys[k] = *first;
+            }
+            if (previous) previous->next = leaf;
+            previous = leaf;
+            nodes.push_back(leaf);
+            mins.push_back(leaf->keys[0]);
+        }
+
+        while (nodes.size() > 1) {
+            size_t m = nodes.size();
+            size_t parents = (m + kInnerSlots) / (kInnerSlots + 1);
+            std::vector<Node*> upper;
+            std::vector<int> upperMins;
+            size_t c = 0;
+            for (size_t j = 0; j < parents; ++j) {
+                Inner* inner = new Inner();
+                size_t end = m * (j + 1) / parents;
+                upperMins.push_back(mins[c]);
+                inner->children[0] = nodes[c++];
+                for (; c < end; ++c) {
+                    inner->keys[inner->count] = mins[c];
+                    inner->children[++inner->count] = nodes[c];
+                }
+                upper.push_back(inner);
+            }
+            nodes.swap(upper);
+            mins.swap(upperMins);
+            ++levels;
+        }
+        root = nodes[0];
+    }
+
+private:
+    // Высота дерева из n ключей не больше log_{kMinInnerKeys + 1}(n) + 1; 16 уровней
+    // хватает с огромным запасом
+    static const int kMaxLevels = 16;
+
+    Node* root;
+    int levels;     // Число уровней внутренних узлов; при 0 корень — лист
+    size_t count;
+
+    // Самый левый лист, который может содержать key
+    Leaf* findLeaf(int key) const {
+        Node* node = root;
+        for (int l = 0; l < levels; ++l) {
+            Inner* inner = static_cast<Inner*>(node);
+            node = inner->children[countLess<kInnerSlots>(inner->keys, key)];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    // Делит полный узел при вставке разделителя separator и потомка child
+    // на место i; на выходе separator и child — то, что поднимается выше
+    void splitInner(Inner* inner, int i, int& separator, Node*& child) {
+        int keys[kInnerSlots + 1];
+        Node* children[kInnerSlots + 2];
+        std::copy(inner->keys, inner->keys + i, keys);
+        keys[i] = separator;
+        std::copy(inner->keys + i, inner->keys + kInnerSlots, keys + i + 1);
+        std::copy(inner->children, inner->children + i + 1, children);
+        children[i + 1] = child;
+        std::copy(inner->children + i + 1, inner->children + kInnerSlots + 1, children + i + 2);
+
+        int mid = (kInnerSlots + 1) / 2; // keys[mid] поднимается в родителя
+        Inner* right = new Inner();
+        right->count = kInnerSlots - mid;
+        std::copy(keys + mid + 1, keys + kInnerSlots + 1, right->keys);
+        std::copy(children + mid + 1, children + kInnerSlots + 2, right->children);
+        inner->count = mid;
+        std::copy(keys, keys + mid, inner->keys);
+        std::fill(inner->keys + mid, inner->keys + kInnerSlots, INT_MAX);
+        std::copy(children, children + mid + 1, inner->children);
+
+        separator = keys[mid];
+        child = right;
+    }
+
+    // Удаление из поддерева с level уровнями внутренних узлов над листьями
+    bool removeFrom(Node* node, int level, int key) {
+        if (level == 0) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            int pos = countLess<kLeafSlots>(leaf->keys, key);
+            if (pos == leaf->count || leaf->keys[pos] != key) {
+                return false;
+            }
+            eraseKey(leaf->keys, leaf->count, pos);
+            return true;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = countLess<kInnerSlots>(inner->keys, key); i <= inner->count; ++i) {
+            if (removeFrom(inner->children[i], level - 1, key)) {
+                fixChild(inner, i, level - 1);
+                return true;
+            }
+            // Правее ключ может быть, только если он равен разделителю
+            if (i == inner->count || inner->keys[i] != key) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    static void eraseKey(int* keys, int& count, int pos) {
+        std::copy(keys + pos + 1, keys + count, keys + pos);
+        keys[--count] = INT_MAX;
+    }
+
+    // Удаляет из узла разделитель j и потомка j + 1
+    static void eraseSeparator(Inner* inner, int j) {
+        std::copy(inner->children + j + 2, inner->children + inner->count + 1, inner->children + j + 1);
+        eraseKey(inner->keys, inner->count, j);
+    }
+
+    // После удаления потомок i мог опустеть ниже минимума: занимаем ключ у соседа
+    // или сливаемся с ним
+    void fixChild(Inner* parent, int i, int childLevel) {
+        if (childLevel == 0) {
+            fixLeaf(parent, i);
+        }
+        else {
+            fixInner(parent, i);
+        }
+    }
+
+    void fixLeaf(Inner* parent, int i) {
+        Leaf* leaf = static_cast<Leaf*>(parent->children[i]);
+        if (leaf->count >= kMinLeafKeys) {
+            return;
+        }
+        Leaf* left = i > 0 ? static_cast<Leaf*>(parent->children[i - 1]) : nullptr;
+        Leaf* right = i < parent->count ? static_cast<Leaf*>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > kMinLeafKeys) {
+            std::copy_backward(leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            leaf->keys[0] = left->keys[left->count - 1];
+            ++leaf->count;
+            left->keys[--left->count] = INT_MAX;
+            parent->keys[i - 1] = leaf->keys[0];
+        }
+        else if (right && right->count > kMinLeafKeys) {
+            leaf->keys[leaf->count++] = right->keys[0];
+            eraseKey(right->keys, right->count, 0);
+            parent->keys[i] = right->keys[0];
+        }
+        else {
+            // Сливаем правый из пары в левый
+            int j = left ? i - 1 : i;
+            Leaf* into = static_cast<Leaf*>(parent->children[j]);
+            Leaf* from = static_cast<Leaf*>(parent->children[j + 1]);
+            std::copy(from->keys, from->keys + from->count, into->keys + into->count);
+            into->count += from->count;
+            into->next = from->next;
+            delete from;
+            eraseSeparator(parent, j);
+        }
+    }
+
+    void fixInner(Inner* parent, int i) {
+        Inner* node = static_cast<Inner*>(parent->children[i]);
+        if (node->count >= kMinInnerKeys) {
+            return;
+        }
+        Inner* left = i > 0 ? static_cast<Inner*>(parent->children[i - 1]) : nullptr;
+        Inner* right = i < parent->count ? static_cast<Inner*>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > kMinInnerKeys) {
+            // Разделитель родителя спускается, последний ключ левого соседа поднимается
+            std::copy_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+            std::copy_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+            node->keys[0] = parent->keys[i - 1];
+            node->children[0] = left->children[left->count];
+            ++node->count;
+            parent->keys[i - 1] = left->keys[left->count - 1];
+            left->keys[--left->count] = INT_MAX;
+        }
+        else if (right && right->count > kMinInnerKeys) {
+            node->keys[node->count] = parent->keys[i];
+            node->children[++node->count] = right->children[0];
+            parent->keys[i] = right->keys[0];
+            std::copy(right->children + 1, right->children + right->count + 1, right->children);
+            eraseKey(right->keys, right->count, 0);
+        }
+        else {
+            int j = left ? i - 1 : i;
+            Inner* into = static_cast<Inner*>(parent->children[j]);
+            Inner* from = static_cast<Inner*>(parent->children[j + 1]);
+            into->keys[into->count] = parent->keys[j];
+            std::copy(from->keys, from->keys + from->count, into->keys + into->count + 1);
+            std::copy(from->children, from->children + from->count + 1, into->children + into->count + 1);
+            into->count += from->count + 1;
+            delete from;
+            eraseSeparator(parent, j);
+        }
+    }
+
+    static void destroy(Node* node, int level) {
+        if (level == 0) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = 0; i <= inner->count; ++i) {
+            destroy(inner->children[i], level - 1);
+        }
+        delete inner;
+    }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+};
+
+} // namespace bpt
@@ -1,140 +1,15 @@
-#include <iostream>
-#include <algorithm>
-#include <queue>
+#include "BST.h"
+#include "Trace.h"
+#include "Workload.h"
+
 #include <fstream>
+#include <string>
 #include <vector>
-#include <cstdlib>
 #include <ctime>
 
-class Node {
-public:
-    int value;
-    Node* left;
-    Node* right;
-
-    Node(int val) : value(val), left(nullptr), right(nullptr) {}
-
-    void print() {
-        std::cout << "Node(" << value << ")" << std::endl;
-    }
-
-    void insert(int val) {
-        if (val < value) {
-            if (left == nullptr) {
-                left = new Node(val);
-            }
-            else {
-                left->insert(val);
-            }
-        }
-        else {
-            if (right == nullptr) {
-                right = new Node(val);
-            }
-            else {
-                right->insert(val);
-            }
-        }
-    }
-
-    Node* search(int val) {
-        if (val == value) {
-            return this;
-        }
-        else if (val < value) {
-            return left ? left->search(val) : nullptr;
-        }
-        else {
-            return right ? right->search(val) : nullptr;
-        }
-    }
-
-    Node* findMin() {
-        Node* current = this;
-        while (current && current->left) {
-            current = current->left;
-        }
-        return current;
-    }
-
-    Node* remove(int val) {
-        if (val < value) {
-            if (left) {
-                left = left->remove(val);
-            }
-        }
-        else if (val > value) {
-            if (right) {
-                right = right->remove(val);
-            }
-        }
-        else {
-            if (!left && !right) {
-                delete this;
-                return nullptr;
-            }
-            else if (!left) {
-                Node* temp = right;
-                delete this;
-                return temp;
-            }
-            else if (!right) {
-                Node* temp = left;
-                delete this;
-                return temp;
-            }
-            else {
-                Node* minNode = right->findMin();
-                value = minNode->value;
-                right = right->remove(minNode->value);
-            }
-        }
-        return this;
-    }
-
-    int height() {
-        if (this == nullptr) {
-            return 0;
-        }
-        int leftHeight = left ? left->height() : 0;
-        int rightHeight = right ? right->height() : 0;
-        return std::max(leftHeight, rightHeight) + 1;
-    }
-
-    void preorder() {
-        print();
-        if (left) left->preorder();
-        if (right) right->preorder();
-    }
-
-    void inorder() {
-        if (left) left->inorder();
-        print();
-        if (right) right->inorder();
-    }
-
-    void postorder() {
-        if (left) left->postorder();
-        if (right) right->postorder();
-        print();
-    }
-
-    void levelOrder() {
-        std::queue<Node*> q;
-        q.push(this);
-
-        while (!q.empty()) {
-            Node* current = q.front();
-            q.pop();
-            current->print();
+using bst::Node;
 
-            if (current->left) q.push(current->left);
-            if (current->right) q.push(current->right);
-        }
-    }
-};
-
-int main() {
+int main(int argc, char** argv) {
     setlocale(LC_ALL, "Ru");
 
     // Создаем корень дерева
@@ -191,7 +66,19 @@ int main() {
     std::cout << "Обход в ширину:" << std::endl;
     root->levelOrder();
 
-    srand(time(0)); // Инициализация генератора случайных чисел
+    Node::destroy(root);
+
+    // Ключи по распределению из аргумента: ./BST sorted — отсортированный поток
+    // и т. д. (Workload.h), по умолчанию uniform. Ключи прогона записываются в трассу
+    // keys_BST.trace; запуск с ней в аргументе (./BST keys_BST.trace)
+    // повторяет прогон с теми же ключами
+    std::string source = argc > 1 ? argv[1] : "";
+    workload::Spec spec;
+    spec.keyRange = 50000;
+    spec.seed = static_cast<uint64_t>(time(0));
+    bool generated = source.empty() || workload::parseDistribution(source, spec.distribution);
+    workload::KeyGenerator generator(spec);
+    trace::KeyStream keys(generated ? "" : source, [&generator]() { return generator.next(); });
 
     std::vector<int> n_values = { 10000, 20000, 30000, 40000, 50000 }; // Различные значения n
 
@@ -201,18 +88,22 @@ int main() {
         return 1;
     }
 
+    NodePool<Node> pool; // Узлы каждого прогона берём из пула
+
     for (int n : n_values) {
-        Node* root = new Node(rand() % 50000); // Создаем корень с случайным значением
+        NodePool<Node>::Scope scope(&pool);
+        Node* root = new Node(keys.next()); // Создаем корень с случайным значением
 
         for (int i = 1; i < n; ++i) {
-            root->insert(rand() % 50000); // Вставляем случайные значения
+            root->insert(keys.next()); // Вставляем случайные значения
             int tree_height = root->height(); // Измеряем высоту дерева
             outputFile << "n = " << i + 1 << ", height = " << tree_height << std::endl;
         }
 
-        delete root; // Освобождаем память
+        pool.release(); // Освобождаем память всего дерева разом
     }
 
     outputFile.close(); // Закрываем файл
+    keys.save("keys_BST.trace");
     return 0;
 }
@@ -0,0 +1,445 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "Augment.h"
+#include "BatchSearch.h"
+#include "FrozenTree.h"
+#include "NodePool.h"
+#include "TreeIterator.h"
+#include "TreeStats.h"
+#include "TreeVisit.h"
+
+namespace bst {
+
+class Node : public PoolAllocated<Node> {
+public:
+    int value;
+    int copies;        // Кратность значения; больше 1 только после insertCounted
+    Node* left;
+    Node* right;
+    int subtreeHeight; // Высота поддерева, поддерживается при вставке и удалении
+    SubtreeStats stats; // Размер, сумма, минимум и максимум поддерева
+
+    Node(int val) : value(val), copies(1), left(nullptr), right(nullptr), subtreeHeight(1), stats(val) {}
+
+    // Буфер пути для remove: переиспользуется, чтобы не выделять память на каждую операцию
+    static std::vector<Node*>& pathBuffer() {
+        thread_local std::vector<Node*> path;
+        return path;
+    }
+
+    static const SubtreeStats& statsOf(const Node* node) {
+        static const SubtreeStats empty;
+        return node ? node->stats : empty;
+    }
+
+    // Пересчёт высоты и сводки узла по его потомкам
+    void update() {
+        subtreeHeight = 1 + std::max(left ? left->subtreeHeight : 0, right ? right->subtreeHeight : 0);
+        stats = SubtreeStats::combine(statsOf(left), value, copies, statsOf(right));
+    }
+
+    void print(BufferedWriter& out) const {
+        out << "Node(" << value;
+        if (copies > 1) out << " x" << copies;
+        out << ")\n";
+    }
+
+    void print() const {
+        BufferedWriter out(std::cout);
+        print(out);
+    }
+
+    // Вставка без рекурсии: дерево из отсортированных ключей вырождается в список
+    // глубины n, и рекурсивный спуск переполнил бы стек
+    void insert(int val) {
+        insertValue(val, false);
+    }
+
+    // Вставка в режиме мультимножества: повтор значения увеличивает кратность
+    // его узла вместо нового узла, так что горячий ключ не удлиняет дерево
+    void insertCounted(int val) {
+        insertValue(val, true);
+    }
+
+    void insertValue(int val, bool counted) {
+        Node* current = this;
+        int depth = 1;
+        while (true) {
+            if (counted && current->value == val) {
+                // Высоты не меняются: значение добавляется в сводки пути и самого узла
+                ++current->copies;
+                for (Node* node = this; node != current; node = val < node->value ? node->left : node->right) {
+                    node->stats.add(val);
+                }
+                current->stats.add(val);
+                return;
+            }
+            Node*& child = val < current->value ? current->left : current->right;
+            ++depth;
+            if (child == nullptr) {
+                child = new Node(val);
+                break;
+            }
+            current = child;
+        }
+
+        // Второй проход по тому же пути: узел на глубине i теперь содержит лист
+        // на глубине depth, значит его высота не меньше depth - i + 1,
+        // а в сводку поддерева добавляется новое значение
+        current = this;
+        for (int i = 1; i < depth; ++i) {
+            if (current->subtreeHeight < depth - i + 1) {
+                current->subtreeHeight = depth - i + 1;
+            }
+            current->stats.add(val);
+            current = val < current->value ? current->left : current->right;
+        }
+    }
+
+    Node* search(int val) {
+        Node* current = this;
+        int descended = 0; // Для TreeStats.h; без TREE_STATS компилятор его выбросит
+        while (current && current->value != val) {
+            current = val < current->value ? current->left : current->right;
+            ++descended;
+        }
+        treestats::searched(descended, current != nullptr);
+        return current;
+    }
+
+    // Пакетный поиск: results[i] — найдено ли keys[i]; поиски идут вперемешку
+    // с предвыборкой, чтобы промахи кэша перекрывались
+    void searchBatch(const int* keys, size_t n, bool* results) const {
+        searchInterleaved(this, keys, n, results);
+    }
+
+    // Сколько раз встречается val (с учётом кратностей)
+    int count(int val) const {
+        return countOf(this, val);
+    }
+
+    Node* findMin() {
+        Node* current = this;
+        while (current && current->left) {
+            current = current->left;
+        }
+        return current;
+    }
+
+    // Удаление одного вхождения без рекурсии; возвращает новый корень. Путь
+    // от корня копится в буфере потока, чтобы затем пересчитать высоты снизу
+    // вверх. У кратного значения уменьшается кратность, узел остаётся
+    Node* remove(int val) {
+        std::vector<Node*>& path = pathBuffer();
+        path.clear();
+
+        Node* root = this;
+        Node** link = &root;
+        while (*link && (*link)->value != val) {
+            Node* node = *link;
+            path.push_back(node);
+            link = val < node->value ? &node->left : &node->right;
+        }
+
+        Node* target = *link;
+        if (!target) {
+            return root;
+        }
+
+        if (target->copies > 1) {
+            --target->copies;
+            path.push_back(target);
+        }
+        else if (target->left && target->right) {
+            // Два потомка: переносим сюда минимум правого поддерева и удаляем его узел
+            path.push_back(target);
+            Node** minLink = &target->right;
+            while ((*minLink)->left) {
+                path.push_back(*minLink);
+                minLink = &(*minLink)->left;
+            }
+            Node* minNode = *minLink;
+            target->value = minNode->value;
+            target->copies = minNode->copies;
+            *minLink = minNode->right;
+            delete minNode;
+        }
+        else {
+            *link = target->left ? target->left : target->right;
+            delete target;
+        }
+
+        for (size_t i = path.size(); i > 0; --i) {
+            path[i - 1]->update();
+        }
+        return root;
+    }
+
+    // O(1): высота хранится в узле
+    int height() {
+        return subtreeHeight;
+    }
+
+    // Число значений, меньших val
+    int rank(int val) const {
+        return rankOf(this, val);
+    }
+
+    // Узел с k-м по возрастанию значением (k с нуля) или nullptr
+    Node* select(int k) {
+        return selectNode(this, k);
+    }
+
+    // Число, сумма, минимум и максимум значений из [lo, hi]
+    SubtreeStats rangeAggregate(int lo, int hi) const {
+        return aggregateRange(this, lo, hi);
+    }
+
+    // Строит идеально сбалансированное дерево из отсортированного диапазона
+    // за O(n): середина становится корнем, половины — поддеревьями
+    template <class It>
+    static Node* buildFromSorted(It first, It last) {
+        return buildBalanced(first, static_cast<size_t>(std::distance(first, last)));
+    }
+
+    // Первые n значений из it; рекурсия глубиной log n, it сдвигается по мере построения
+    template <class It>
+    static Node* buildBalanced(It& it, size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        Node* leftTree = buildBalanced(it, n / 2);
+        Node* node = new Node(*it);
+        ++it;
+        node->left = leftTree;
+        node->right = buildBalanced(it, n - n / 2 - 1);
+        node->update();
+        return node;
+    }
+
+    // Пакетная вставка: ключи сортируются и раздаются по дереву за один спуск —
+    // каждый узел посещается один раз на весь пакет, а на месте пустого потомка
+    // сразу строится сбалансированное поддерево из попавших туда ключей.
+    // Возвращает новый корень (root может быть nullptr)
+    static Node* insertBatch(Node* root, std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        return insertSorted(root, keys.data(), keys.data() + keys.size(), 0);
+    }
+
+    // Пакетное удаление: по одному вхождению на каждый ключ пакета
+    static Node* removeBatch(Node* root, std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        std::vector<std::pair<int, int>> counted; // (значение, сколько вхождений ещё удалить)
+        for (int k : keys) {
+            if (!counted.empty() && counted.back().first == k) {
+                ++counted.back().second;
+            }
+            else {
+                counted.push_back(std::make_pair(k, 1));
+            }
+        }
+        return removeSorted(root, counted.data(), counted.data() + counted.size(), 0);
+    }
+
+    // Глубже этого уровня пакет обрабатывается по одному ключу: спуск рекурсивный,
+    // а вырожденное дерево может быть глубиной n
+    static const int kMaxBatchDepth = 4096;
+
+    static Node* insertSorted(Node* node, const int* first, const int* last, int depth) {
+        if (first == last) {
+            return node;
+        }
+        if (!node) {
+            return buildBalanced(first, static_cast<size_t>(last - first));
+        }
+        if (depth >= kMaxBatchDepth) {
+            for (; first != last; ++first) node->insert(*first);
+            return node;
+        }
+        // Меньшие ключи уходят влево, равные и большие — вправо, как в insert
+        const int* mid = std::lower_bound(first, last, node->value);
+        node->left = insertSorted(node->left, first, mid, depth + 1);
+        node->right = insertSorted(node->right, mid, last, depth + 1);
+        node->update();
+        return node;
+    }
+
+    static Node* removeSorted(Node* node, std::pair<int, int>* first, std::pair<int, int>* last, int depth) {
+        if (!node || first == last) {
+            return node;
+        }
+        if (depth >= kMaxBatchDepth) {
+            for (; first != last; ++first) {
+                for (; first->second > 0 && node && node->search(first->first); --first->second) {
+                    node = node->remove(first->first);
+                }
+            }
+            return node;
+        }
+
+        std::pair<int, int>* mid = std::lower_bound(first, last, node->value,
+            [](const std::pair<int, int>& p, int v) { return p.first < v; });
+        std::pair<int, int>* equal = (mid != last && mid->first == node->value) ? mid : nullptr;
+        // Кратный узел сразу забирает до copies вхождений
+        int taken = equal ? std::min(equal->second, node->copies) : 0;
+        if (equal) equal->second -= taken;
+        node->copies -= taken;
+        bool removeSelf = taken > 0 && node->copies == 0;
+
+        // Счётчик равных ключей виден обоим поддеревьям: сколько не нашлось справа,
+        // поищем слева (после buildFromSorted равные бывают и там)
+        node->right = removeSorted(node->right, mid, last, depth + 1);
+        node->left = removeSorted(node->left, first, equal ? mid + 1 : mid, depth + 1);
+
+        if (removeSelf) {
+            return removeRoot(node);
+        }
+        node->update();
+        return node;
+    }
+
+    // Удаляет корень поддерева, возвращает новый корень
+    static Node* removeRoot(Node* node) {
+        if (!node->left || !node->right) {
+            Node* child = node->left ? node->left : node->right;
+            delete node;
+            return child;
+        }
+        Node* first = nullptr;
+        node->right = removeFirst(node->right, first);
+        node->value = first->value;
+        node->copies = first->copies;
+        delete first;
+        node->update();
+        return node;
+    }
+
+    // Отцепляет наименьший узел поддерева в first, возвращает новый корень.
+    // Спуск по левому краю без рекурсии: вырожденное дерево бывает глубиной n
+    static Node* removeFirst(Node* node, Node*& first) {
+        std::vector<Node*>& path = pathBuffer();
+        path.clear();
+        Node* root = node;
+        Node** link = &root;
+        while ((*link)->left) {
+            path.push_back(*link);
+            link = &(*link)->left;
+        }
+        first = *link;
+        *link = first->right;
+        for (size_t i = path.size(); i > 0; --i) {
+            path[i - 1]->update();
+        }
+        return root;
+    }
+
+    // Неизменяемый снимок для поиска без указателей: один симметричный обход
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        sorted.reserve(stats.size);
+        inorder([&sorted](const Node* node) { sorted.insert(sorted.end(), node->copies, node->value); });
+        return FrozenTree(sorted);
+    }
+
+    // Итераторы по возрастанию значений (Node — корень дерева); кратный узел —
+    // один шаг итератора, его кратность — node()->copies
+    typedef PathIterator<Node> Iterator;
+
+    Iterator begin() {
+        return Iterator::first(this);
+    }
+
+    Iterator end() {
+        return Iterator(this);
+    }
+
+    // Первый узел со значением >= val
+    Iterator lowerBound(int val) {
+        return Iterator::lowerBound(this, val);
+    }
+
+    // Первый узел со значением > val
+    Iterator upperBound(int val) {
+        return Iterator::upperBound(this, val);
+    }
+
+    // Значения из отрезка [lo, hi] по возрастанию
+    IteratorRange<Iterator> range(int lo, int hi) {
+        if (lo > hi) {
+            return IteratorRange<Iterator>(end(), end());
+        }
+        return IteratorRange<Iterator>(lowerBound(lo), upperBound(hi));
+    }
+
+    // Вызывает visit(value) для значений из [lo, hi] по возрастанию,
+    // кратное значение — copies раз
+    template <class F>
+    void scan(int lo, int hi, F visit) {
+        for (Iterator it = lowerBound(lo); it.node() && *it <= hi; ++it) {
+            for (int i = it.node()->copies; i > 0; --i) visit(*it);
+        }
+    }
+
+    // Удаляем всё дерево без рекурсии (вырожденное BST может быть глубиной n)
+    static void destroy(Node* root) {
+        std::vector<Node*> stack;
+        if (root) stack.push_back(root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            if (node->left) stack.push_back(node->left);
+            if (node->right) stack.push_back(node->right);
+            delete node;
+        }
+    }
+
+    // Обходы с посетителем: visit(Node*) для каждого узла, без ввода-вывода
+    template <class Visitor>
+    void preorder(Visitor&& visit) {
+        visitPreorder(this, visit);
+    }
+
+    template <class Visitor>
+    void inorder(Visitor&& visit) {
+        visitInorder(this, visit);
+    }
+
+    template <class Visitor>
+    void postorder(Visitor&& visit) {
+        visitPostorder(this, visit);
+    }
+
+    template <class Visitor>
+    void levelOrder(Visitor&& visit) {
+        visitLevelOrder(this, visit);
+    }
+
+    // Печать обходов: вывод буферизован и уходит в std::cout крупными кусками
+    void preorder() {
+        BufferedWriter out(std::cout);
+        preorder(PrintVisitor<Node>(out));
+    }
+
+    void inorder() {
+        BufferedWriter out(std::cout);
+        inorder(PrintVisitor<Node>(out));
+    }
+
+    void postorder() {
+        BufferedWriter out(std::cout);
+        postorder(PrintVisitor<Node>(out));
+    }
+
+    void levelOrder() {
+        BufferedWriter out(std::cout);
+        levelOrder(PrintVisitor<Node>(out));
+    }
+};
+
+} // namespace bst
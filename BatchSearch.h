@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+#include "TreeStats.h"
+
+// Поиск пакета ключей вперемешку (AMAC): до kSearchGroup поисков идут
+// одновременно, каждый шаг одного поиска — сравнение в узле, который уже
+// запрошен предвыборкой, и предвыборка следующего узла. Пока один поиск ждёт
+// память, процессор занят остальными, так что промахи кэша перекрываются.
+// Закончившийся поиск сразу освобождает место следующему ключу пакета.
+
+const int kSearchGroup = 16;
+
+// results[i] = есть ли keys[i] в дереве. Работает с любым узлом с value, left,
+// right; nil — фиктивный лист (TNULL у красно-чёрного дерева), для BST и AVL nullptr
+template <class Node>
+void searchInterleaved(const Node* root, const int* keys, size_t n, bool* results, const Node* nil = nullptr) {
+    const Node* node[kSearchGroup];
+    size_t index[kSearchGroup];
+    int descended[kSearchGroup]; // Для TreeStats.h; без TREE_STATS компилятор его выбросит
+    int active = 0;
+    size_t next = 0;
+    for (; active < kSearchGroup && next < n; ++active, ++next) {
+        node[active] = root;
+        index[active] = next;
+        descended[active] = 0;
+    }
+    __builtin_prefetch(root);
+
+    while (active > 0) {
+        for (int j = 0; j < active; ++j) {
+            const Node* x = node[j];
+            int key = keys[index[j]];
+            if (x != nil && x->value != key) {
+                x = key < x->value ? x->left : x->right;
+                __builtin_prefetch(x);
+                node[j] = x;
+                ++descended[j];
+                continue;
+            }
+            results[index[j]] = x != nil;
+            treestats::searched(descended[j], x != nil);
+            if (next < n) {
+                node[j] = root;
+                index[j] = next++;
+                descended[j] = 0;
+            }
+            else {
+                // Переносим последний активный поиск на место законченного
+                --active;
+                node[j] = node[active];
+                index[j] = index[active];
+                descended[j] = descended[active];
+                --j;
+            }
+        }
+    }
+}
@@ -0,0 +1,1067 @@
+#include "Engines.h"
+#include "PerfCounters.h"
+#include "ShardedTree.h"
+#include "Snapshot.h"
+#include "Trace.h"
+#include "TreeStats.h"
+#include "Workload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Общий бенчмарк для BST, AVL, красно-чёрного и B+ дерева и BST без блокировок.
+//
+// Пример:
+//   ./benchmark --engines bst,avl,rb --n 100000 --phases insert,search,remove,clear --format json
+//
+// Для каждой фазы выводятся ns/op, ops/s и перцентили задержки p50/p99/p999.
+// Пропускная способность считается по общему времени фазы; перцентили —
+// по замеру каждой операции (его можно отключить флагом --no-latency).
+
+namespace {
+
+struct Config {
+    std::vector<std::string> engines = { "bst", "avl", "rb" };
+    std::vector<std::string> phases = { "insert", "search", "remove" };
+    int n = 100000;          // Количество вставляемых ключей
+    int searches = -1;       // Количество поисков (по умолчанию n)
+    int keyRange = -1;       // Ключи берутся из [0, keyRange) (по умолчанию 10 * n)
+    int batch = 10000;       // Размер пакета для insert-batch / remove-batch
+    int scanLength = 100;    // Фаза scan обходит ключи из [k, k + scanLength)
+    uint64_t seed = 1;
+    bool latency = true;
+    bool pool = false;       // Узлы из NodePool вместо new/delete
+    int threads = 0;         // Потоки *-concurrent, шарды sharded-* (по умолчанию по числу ядер)
+    std::string format = "csv";
+    std::string output;
+    std::string snapshot = "benchmark.snap"; // Файл снимка для *-snapshot
+    std::string record;      // Записать операции фаз в трассу
+    std::string trace;       // Трасса для фазы replay
+    workload::Distribution distribution = workload::UNIFORM;
+    double theta = 0.99;     // Перекос zipfian и latest
+    workload::Mix mix;       // Доли операций фазы mix
+    bool perf = false;       // Аппаратные счётчики на операцию (PerfCounters.h)
+};
+
+struct PhaseResult {
+    std::string engine;
+    std::string phase;
+    int n = 0;
+    long long ops = 0;
+    double totalMs = 0;
+    double nsPerOp = 0;
+    double opsPerSec = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    int height = 0;
+    perf::Reading counters;  // За всю фазу; -1 — счётчик недоступен или --perf не задан
+    treestats::Counters structure; // Повороты, перекраски, пути поиска (сборка с -DTREE_STATS)
+};
+
+// Ключи для всех фаз генерируются один раз, чтобы все движки получали одинаковый поток
+struct Workload {
+    std::vector<int> inserts;
+    std::vector<int> sorted;     // Те же ключи по возрастанию — для фазы build
+    std::vector<int> searches;
+    std::vector<int> removes;
+    std::vector<workload::Operation> mixed; // Операции фазы mix
+    std::shared_ptr<trace::Reader> trace; // --trace, отображённая в память
+};
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+void usage() {
+    std::cerr <<
+        "Использование: benchmark [опции]\n"
+        "  --engines LIST   движки через запятую: bst,avl,rb,bptree,otree-bst,otree-avl,otree-rb,\n"
+        "                   avl-compact, rb-compact (12-байтовые узлы с 32-битными индексами),\n"
+        "                   bst-multiset, avl-multiset, rb-multiset (повтор ключа — кратность\n"
+        "                   узла, а не новый узел),\n"
+        "                   lfbst (BST без блокировок в один поток),\n"
+        "                   rb-concurrent (поиск из --threads потоков без блокировок),\n"
+        "                   pavl (персистентное AVL), pavl-concurrent (поиск по снимкам\n"
+        "                   из --threads потоков при работающем писателе),\n"
+        "                   lfbst-concurrent (вставка, поиск и удаление из --threads потоков),\n"
+        "                   sharded-avl, sharded-rb (--threads шардов по диапазонам ключей,\n"
+        "                   пакетные фазы идут параллельно),\n"
+        "                   avl-sets, rb-sets (объединение, пересечение и разность деревьев\n"
+        "                   из ключей вставки и поиска на split/join),\n"
+        "                   avl-snapshot, rb-snapshot (запись снимка на диск, открытие\n"
+        "                   через mmap, поиск по нему и восстановление дерева)\n"
+        "                   (по умолчанию bst,avl,rb)\n"
+        "  --phases LIST    фазы: insert,build,search,scan,remove,clear (по умолчанию insert,search,remove)\n"
+        "                   build строит дерево из тех же ключей, заранее отсортированных\n"
+        "                   insert-batch, remove-batch — те же ключи пакетами по --batch\n"
+        "                   search-batch — ключи поиска пакетами по --batch, поиски вперемешку\n"
+        "                   scan — обход ключей из [k, k + L) для каждого ключа поиска\n"
+        "                   freeze — снимок дерева в порядке Эйтцингера, search-frozen — поиск по нему\n"
+        "                   replay — операции трассы --trace по порядку\n"
+        "                   traverse — обход всего дерева по возрастанию\n"
+        "                   mix — --searches операций смеси --mix над уже вставленными ключами\n"
+        "  --n N            количество вставок (100000)\n"
+        "  --searches M     количество поисков (n)\n"
+        "  --key-range R    диапазон ключей [0, R) (10 * n)\n"
+        "  --batch B        размер пакета (10000)\n"
+        "  --scan-length L  длина диапазона ключей для фазы scan (100)\n"
+        "  --seed S         зерно генератора (1)\n"
+        "  --distribution D распределение ключей: uniform, zipfian, latest, sorted, reverse,\n"
+        "                   sawtooth, clustered (uniform); см. Workload.h\n"
+        "  --theta T        перекос zipfian и latest, 0 < T < 1 (0.99)\n"
+        "  --mix R:I:D:S    доли чтения, вставки, удаления и скана в фазе mix (50:50:0:0)\n"
+        "  --no-latency     не замерять каждую операцию (только пропускная способность)\n"
+        "  --perf           аппаратные счётчики на операцию: такты, инструкции, промахи L1d,\n"
+        "                   LLC и dTLB, ошибки предсказания переходов (perf_event_open;\n"
+        "                   недоступные остаются пустыми). Замер задержки попадает\n"
+        "                   в счётчики, поэтому лучше вместе с --no-latency\n"
+        "  --pool           выделять узлы из пула (clear освобождает их разом)\n"
+        "  --threads T      потоки движков *-concurrent и шарды sharded-* (число ядер)\n"
+        "                   (у *-concurrent — не больше 127)\n"
+        "  --format F       csv или json (csv)\n"
+        "  --output FILE    файл для результатов (stdout)\n"
+        "  --record FILE    записать операции фаз вставки, поиска и удаления в трассу\n"
+        "  --trace FILE     трасса для фазы replay (пишется --record или trace::Writer)\n"
+        "  --snapshot FILE  файл снимка для *-snapshot (benchmark.snap, удаляется в конце)\n";
+}
+
+bool parseArgs(int argc, char** argv, Config& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Не указано значение для " << name << std::endl;
+                return nullptr;
+            }
+            return argv[++i];
+        };
+        const char* v = nullptr;
+        if (arg == "--engines") {
+            if (!(v = next("--engines"))) return false;
+            cfg.engines = splitList(v);
+        }
+        else if (arg == "--phases") {
+            if (!(v = next("--phases"))) return false;
+            cfg.phases = splitList(v);
+        }
+        else if (arg == "--n") {
+            if (!(v = next("--n"))) return false;
+            cfg.n = std::atoi(v);
+        }
+        else if (arg == "--searches") {
+            if (!(v = next("--searches"))) return false;
+            cfg.searches = std::atoi(v);
+        }
+        else if (arg == "--key-range") {
+            if (!(v = next("--key-range"))) return false;
+            cfg.keyRange = std::atoi(v);
+        }
+        else if (arg == "--batch") {
+            if (!(v = next("--batch"))) return false;
+            cfg.batch = std::atoi(v);
+        }
+        else if (arg == "--scan-length") {
+            if (!(v = next("--scan-length"))) return false;
+            cfg.scanLength = std::atoi(v);
+        }
+        else if (arg == "--seed") {
+            if (!(v = next("--seed"))) return false;
+            cfg.seed = std::strtoull(v, nullptr, 10);
+        }
+        else if (arg == "--distribution") {
+            if (!(v = next("--distribution"))) return false;
+            if (!workload::parseDistribution(v, cfg.distribution)) {
+                std::cerr << "Неизвестное распределение: " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--theta") {
+            if (!(v = next("--theta"))) return false;
+            cfg.theta = std::atof(v);
+        }
+        else if (arg == "--mix") {
+            if (!(v = next("--mix"))) return false;
+            if (!workload::parseMix(v, cfg.mix)) {
+                std::cerr << "Смесь задаётся как R:I:D:S, например 95:5:0:0: " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--no-latency") {
+            cfg.latency = false;
+        }
+        else if (arg == "--perf") {
+            cfg.perf = true;
+        }
+        else if (arg == "--pool") {
+            cfg.pool = true;
+        }
+        else if (arg == "--threads") {
+            if (!(v = next("--threads"))) return false;
+            cfg.threads = std::atoi(v);
+        }
+        else if (arg == "--format") {
+            if (!(v = next("--format"))) return false;
+            cfg.format = v;
+        }
+        else if (arg == "--output") {
+            if (!(v = next("--output"))) return false;
+            cfg.output = v;
+        }
+        else if (arg == "--record") {
+            if (!(v = next("--record"))) return false;
+            cfg.record = v;
+        }
+        else if (arg == "--trace") {
+            if (!(v = next("--trace"))) return false;
+            cfg.trace = v;
+        }
+        else if (arg == "--snapshot") {
+            if (!(v = next("--snapshot"))) return false;
+            cfg.snapshot = v;
+        }
+        else if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        else {
+            std::cerr << "Неизвестная опция: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (cfg.n <= 0) {
+        std::cerr << "--n должно быть положительным" << std::endl;
+        return false;
+    }
+    if (cfg.format != "csv" && cfg.format != "json") {
+        std::cerr << "Неизвестный формат: " << cfg.format << std::endl;
+        return false;
+    }
+    if (cfg.batch <= 0) {
+        std::cerr << "--batch должно быть положительным" << std::endl;
+        return false;
+    }
+    if (cfg.scanLength <= 0) {
+        std::cerr << "--scan-length должно быть положительным" << std::endl;
+        return false;
+    }
+    if (!(cfg.theta > 0 && cfg.theta < 1)) {
+        std::cerr << "--theta должно быть в (0, 1)" << std::endl;
+        return false;
+    }
+    // Потоки движков *-concurrent занимают слоты EpochDomain (Epoch.h), и ещё
+    // один слот нужен главному потоку: больше потоков домен не вместит
+    const int maxConcurrentThreads = EpochThreadId::kMaxThreads - 1;
+    bool concurrent = false;
+    for (const std::string& e : cfg.engines) {
+        if (e.size() > 11 && e.compare(e.size() - 11, 11, "-concurrent") == 0) concurrent = true;
+    }
+    if (concurrent && cfg.threads > maxConcurrentThreads) {
+        std::cerr << "--threads для движков *-concurrent — не больше " << maxConcurrentThreads << std::endl;
+        return false;
+    }
+    if (cfg.threads <= 0) {
+        cfg.threads = std::max(1u, std::thread::hardware_concurrency());
+        if (concurrent) cfg.threads = std::min(cfg.threads, maxConcurrentThreads);
+    }
+    if (cfg.searches < 0) cfg.searches = cfg.n;
+    if (cfg.keyRange <= 0) cfg.keyRange = cfg.n > 200000000 ? 2000000000 : cfg.n * 10;
+    return true;
+}
+
+Workload makeWorkload(const Config& cfg) {
+    Workload w;
+    workload::Spec spec;
+    spec.distribution = cfg.distribution;
+    spec.keyRange = cfg.keyRange;
+    spec.theta = cfg.theta;
+    spec.seed = cfg.seed;
+    workload::Random rng(workload::mix64(cfg.seed));
+
+    workload::KeyGenerator keys(spec);
+    w.inserts = keys.take(cfg.n);
+
+    w.sorted = w.inserts;
+    std::sort(w.sorted.begin(), w.sorted.end());
+
+    // zipfian и latest спрашивают вставленные ключи; иначе, как и раньше,
+    // ключи поиска равномерны по диапазону и большей частью промахиваются
+    w.searches.resize(cfg.searches);
+    if (cfg.distribution == workload::ZIPFIAN || cfg.distribution == workload::LATEST) {
+        workload::RequestChooser chooser(spec, rng());
+        for (int& k : w.searches) k = chooser.choose(w.inserts);
+    }
+    else {
+        for (int& k : w.searches) k = static_cast<int>(rng.below(cfg.keyRange));
+    }
+
+    // Удаляем ровно вставленные ключи в случайном порядке
+    w.removes = w.inserts;
+    std::shuffle(w.removes.begin(), w.removes.end(), rng);
+
+    if (std::find(cfg.phases.begin(), cfg.phases.end(), "mix") != cfg.phases.end()) {
+        // Смесь продолжает поток вставок: новые ключи — следующие за w.inserts
+        workload::OperationGenerator mixed(spec, cfg.mix);
+        mixed.load(w.inserts);
+        w.mixed = mixed.take(cfg.searches);
+    }
+
+    if (!cfg.trace.empty()) w.trace = std::make_shared<trace::Reader>(cfg.trace);
+    return w;
+}
+
+// Трасса тех же операций, что выполнят фазы --phases: её можно повторить
+// фазой replay на другом движке, в другом прогоне или на другой машине
+void recordWorkload(const Config& cfg, const Workload& w) {
+    trace::Writer writer;
+    for (const std::string& phase : cfg.phases) {
+        if (phase == "insert" || phase == "insert-batch") writer.recordAll(trace::INSERT, w.inserts);
+        else if (phase == "search" || phase == "search-batch") writer.recordAll(trace::SEARCH, w.searches);
+        else if (phase == "remove" || phase == "remove-batch") writer.recordAll(trace::REMOVE, w.removes);
+        else if (phase == "scan") writer.recordAll(trace::SCAN, w.searches);
+        else if (phase == "mix") {
+            for (const workload::Operation& o : w.mixed) writer.record(o.op, o.key);
+        }
+    }
+    writer.save(cfg.record);
+}
+
+// Счётчики --perf; nullptr — не замеряются. Их охватывают timeIndexed и timeOnce,
+// так что любая фаза любого движка получает их без отдельного кода
+perf::Counters* g_counters = nullptr;
+
+double percentile(std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(q * (sorted.size() - 1));
+    return static_cast<double>(sorted[idx]);
+}
+
+// Прогоняет op(i) для i из [0, count) и собирает статистику
+template <class Op>
+PhaseResult timeIndexed(const Config& cfg, size_t count, Op op) {
+    PhaseResult r;
+    r.ops = static_cast<long long>(count);
+    std::vector<uint64_t> lat;
+    if (cfg.latency) lat.resize(count); // Заранее: обнуление массива не должно попасть в замер
+
+    treestats::reset();
+    if (g_counters) g_counters->start();
+    Clock::time_point start = Clock::now();
+    if (cfg.latency) {
+        Clock::time_point prev = start;
+        for (size_t i = 0; i < count; ++i) {
+            op(i);
+            Clock::time_point now = Clock::now();
+            lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - prev).count();
+            prev = now;
+        }
+    }
+    else {
+        for (size_t i = 0; i < count; ++i) op(i);
+    }
+    Clock::time_point end = Clock::now();
+    if (g_counters) r.counters = g_counters->stop();
+    r.structure = treestats::snapshot();
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    r.totalMs = ns / 1e6;
+    r.nsPerOp = r.ops ? ns / r.ops : 0;
+    r.opsPerSec = ns > 0 ? r.ops * 1e9 / ns : 0;
+
+    if (!lat.empty()) {
+        std::sort(lat.begin(), lat.end());
+        r.p50 = percentile(lat, 0.50);
+        r.p99 = percentile(lat, 0.99);
+        r.p999 = percentile(lat, 0.999);
+    }
+    return r;
+}
+
+// Прогоняет op по всем ключам фазы
+template <class Op>
+PhaseResult timePhase(const Config& cfg, const std::vector<int>& keys, Op op) {
+    return timeIndexed(cfg, keys.size(), [&](size_t i) { op(keys[i]); });
+}
+
+// Пакетная фаза: op получает очередной пакет ключей. ops — число ключей,
+// перцентили задержки считаются по пакетам
+template <class Op>
+PhaseResult timeBatches(const Config& cfg, const std::vector<int>& keys, Op op) {
+    std::vector<std::vector<int>> batches;
+    for (size_t i = 0; i < keys.size(); i += cfg.batch) {
+        size_t end = std::min(keys.size(), i + static_cast<size_t>(cfg.batch));
+        batches.push_back(std::vector<int>(keys.begin() + i, keys.begin() + end));
+    }
+    std::vector<int> index(batches.size());
+    for (size_t i = 0; i < index.size(); ++i) index[i] = static_cast<int>(i);
+
+    PhaseResult r = timePhase(cfg, index, [&](int i) { op(batches[i]); });
+    r.ops = static_cast<long long>(keys.size());
+    double ns = r.totalMs * 1e6;
+    r.nsPerOp = r.ops ? ns / r.ops : 0;
+    r.opsPerSec = ns > 0 ? r.ops * 1e9 / ns : 0;
+    return r;
+}
+
+// Замер одной операции над всем деревом (build, clear); ops — сколько ключей она затронула
+template <class Op>
+PhaseResult timeOnce(long long ops, Op op) {
+    PhaseResult r;
+    r.ops = ops;
+    treestats::reset();
+    if (g_counters) g_counters->start();
+    Clock::time_point start = Clock::now();
+    op();
+    Clock::time_point end = Clock::now();
+    if (g_counters) r.counters = g_counters->stop();
+    r.structure = treestats::snapshot();
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    r.totalMs = ns / 1e6;
+    r.nsPerOp = ops ? ns / ops : 0;
+    r.opsPerSec = ns > 0 ? ops * 1e9 / ns : 0;
+    return r;
+}
+
+// Результат поиска копится сюда, чтобы компилятор не выбросил вызовы
+volatile long long g_sink = 0;
+
+template <class Engine>
+void runPhases(const Config& cfg, const Workload& w, Engine& engine, std::vector<PhaseResult>& results) {
+    FrozenTree frozen;
+    for (const std::string& phase : cfg.phases) {
+        PhaseResult r;
+        if (phase == "insert") {
+            r = timePhase(cfg, w.inserts, [&](int k) { engine.insert(k); });
+        }
+        else if (phase == "search") {
+            long long found = 0;
+            r = timePhase(cfg, w.searches, [&](int k) { found += engine.search(k); });
+            g_sink = g_sink + found;
+        }
+        else if (phase == "freeze") {
+            // Снимок в порядке Эйтцингера из текущего содержимого дерева
+            r = timeOnce(static_cast<long long>(w.inserts.size()), [&]() { frozen = engine.freeze(); });
+        }
+        else if (phase == "search-frozen") {
+            // Поиск по снимку; если фазы freeze не было, снимок строится вне замера
+            if (frozen.size() == 0) frozen = engine.freeze();
+            long long found = 0;
+            r = timePhase(cfg, w.searches, [&](int k) { found += frozen.contains(k); });
+            g_sink = g_sink + found;
+        }
+        else if (phase == "scan") {
+            // Ключи поиска служат началами диапазонов; ops — число сканов
+            long long visited = 0;
+            r = timePhase(cfg, w.searches, [&](int k) {
+                int hi = k > INT_MAX - cfg.scanLength ? INT_MAX : k + cfg.scanLength - 1;
+                visited += engine.scan(k, hi);
+            });
+            g_sink = g_sink + visited;
+        }
+        else if (phase == "traverse") {
+            // Весь обход по возрастанию; ops — число пройденных ключей
+            long long visited = 0;
+            r = timeOnce(static_cast<long long>(w.inserts.size()), [&]() { visited = engine.scan(INT_MIN, INT_MAX); });
+            g_sink = g_sink + visited;
+        }
+        else if (phase == "search-batch") {
+            // Те же ключи поиска пакетами по --batch через searchBatch
+            std::unique_ptr<bool[]> found(new bool[cfg.batch]);
+            long long total = 0;
+            r = timeBatches(cfg, w.searches, [&](const std::vector<int>& b) {
+                engine.searchBatch(b.data(), b.size(), found.get());
+                for (size_t i = 0; i < b.size(); ++i) total += found[i];
+            });
+            g_sink = g_sink + total;
+        }
+        else if (phase == "remove") {
+            r = timePhase(cfg, w.removes, [&](int k) { engine.remove(k); });
+        }
+        else if (phase == "insert-batch") {
+            r = timeBatches(cfg, w.inserts, [&](const std::vector<int>& b) { engine.insertBatch(b); });
+        }
+        else if (phase == "remove-batch") {
+            r = timeBatches(cfg, w.removes, [&](const std::vector<int>& b) { engine.removeBatch(b); });
+        }
+        else if (phase == "replay") {
+            // Операции трассы --trace по порядку; ключи читаются прямо из отображения
+            if (!w.trace) {
+                std::cerr << "Фазе replay нужна трасса: --trace FILE" << std::endl;
+                continue;
+            }
+            const trace::Reader& t = *w.trace;
+            long long found = 0;
+            r = timeIndexed(cfg, t.size(), [&](size_t i) { found += trace::apply(engine, t.op(i), t.key(i), cfg.scanLength); });
+            g_sink = g_sink + found;
+        }
+        else if (phase == "mix") {
+            // Смесь --mix по ключам --distribution; осмысленна после insert или build
+            long long found = 0;
+            r = timeIndexed(cfg, w.mixed.size(), [&](size_t i) {
+                found += trace::apply(engine, w.mixed[i].op, w.mixed[i].key, cfg.scanLength);
+            });
+            g_sink = g_sink + found;
+        }
+        else if (phase == "build") {
+            // Построение из отсортированных ключей вместо n вставок
+            r = timeOnce(static_cast<long long>(w.sorted.size()), [&]() { engine.buildFromSorted(w.sorted); });
+        }
+        else if (phase == "clear") {
+            // Одна операция: разрушение всего дерева
+            r = timeOnce(1, [&]() { engine.clear(); });
+        }
+        else {
+            std::cerr << "Неизвестная фаза: " << phase << std::endl;
+            continue;
+        }
+        r.engine = std::string(Engine::name()) + (cfg.pool ? "+pool" : "");
+        r.phase = phase;
+        r.n = cfg.n;
+        r.height = engine.height();
+        results.push_back(r);
+    }
+}
+
+template <class Engine>
+void runEngine(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    Engine engine(cfg.pool);
+    runPhases(cfg, w, engine, results);
+}
+
+// Шардированное дерево: по шарду и рабочему потоку на каждый из --threads
+template <class Shard>
+void runSharded(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    ShardedTree<Shard> engine(cfg.pool, cfg.threads);
+    runPhases(cfg, w, engine, results);
+}
+
+// OrderedTree берёт пул через параметр шаблона Allocator
+template <class Policy>
+void runOrderedTree(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    if (cfg.pool) {
+        runEngine<OrderedTreeEngine<Policy, PoolAllocator<std::pair<const int, int>>>>(cfg, w, results);
+    }
+    else {
+        runEngine<OrderedTreeEngine<Policy>>(cfg, w, results);
+    }
+}
+
+// Чтение из нескольких потоков при одном писателе: фазы не настраиваются.
+// Дерево заполняется ключами вставки, затем --threads потоков ищут каждый
+// все ключи поиска — сначала одни (search-mt), затем параллельно с писателем,
+// который удаляет и возвращает ключи (search-mt-write). ops — все поиски всех потоков.
+// Shared — дерево и способ чтения: Shared::Reader живёт в потоке читателя
+
+// Красно-чёрное дерево с читателями без блокировок
+struct RBConcurrentReads {
+    rb::RedBlackTree tree;
+
+    static const char* name() { return "rb-concurrent"; }
+    RBConcurrentReads() { tree.enableConcurrentReads(); }
+    void insert(int key) { tree.insert(key); }
+    void remove(int key) { tree.erase(key); }
+    int height() { return tree.getHeight(); }
+
+    struct Reader {
+        RBConcurrentReads& shared;
+        explicit Reader(RBConcurrentReads& s) : shared(s) {}
+        bool search(int key) { return shared.tree.concurrentSearch(key); }
+    };
+};
+
+// Персистентное AVL-дерево: читатель ищет по своему снимку и берёт свежий
+// раз в kRefresh поисков, как долгий отчёт, который время от времени обновляется
+struct PersistentSnapshotReads {
+    pavl::SnapshotTree tree;
+
+    static const char* name() { return "pavl-concurrent"; }
+    void insert(int key) { tree.insert(key); }
+    void remove(int key) { tree.remove(key); }
+    int height() { return tree.current().height(); }
+
+    struct Reader {
+        static const int kRefresh = 1024;
+        PersistentSnapshotReads& shared;
+        pavl::Version snapshot;
+        int left;
+        explicit Reader(PersistentSnapshotReads& s) : shared(s), left(0) {}
+        bool search(int key) {
+            if (--left <= 0) {
+                snapshot = shared.tree.snapshot();
+                left = kRefresh;
+            }
+            return snapshot.contains(key);
+        }
+    };
+};
+
+template <class Shared>
+void runConcurrentReads(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    Shared shared;
+    for (int k : w.inserts) shared.insert(k);
+
+    for (int withWriter = 0; withWriter < 2; ++withWriter) {
+        std::atomic<int> readersLeft(cfg.threads);
+        std::atomic<long long> found(0);
+        long long writes = 0;
+        PhaseResult r = timeOnce(static_cast<long long>(w.searches.size()) * cfg.threads, [&]() {
+            std::vector<std::thread> readers;
+            for (int t = 0; t < cfg.threads; ++t) {
+                readers.emplace_back([&, t]() {
+                    typename Shared::Reader reader(shared);
+                    long long local = 0;
+                    // Каждый поток начинает со своего места, чтобы не идти в ногу
+                    size_t n = w.searches.size();
+                    for (size_t i = 0; i < n; ++i) {
+                        local += reader.search(w.searches[(i + n / cfg.threads * t) % n]);
+                    }
+                    found += local;
+                    --readersLeft;
+                });
+            }
+            if (withWriter) {
+                // Единственный писатель работает, пока не закончат читатели
+                for (size_t i = 0; readersLeft.load() > 0; i = (i + 1) % w.removes.size()) {
+                    shared.remove(w.removes[i]);
+                    shared.insert(w.removes[i]);
+                    writes += 2;
+                }
+            }
+            for (std::thread& th : readers) th.join();
+        });
+        g_sink = g_sink + found.load() + writes;
+        r.engine = Shared::name();
+        r.phase = withWriter ? "search-mt-write" : "search-mt";
+        r.n = cfg.n;
+        r.height = shared.height();
+        results.push_back(r);
+    }
+}
+
+// Операции над множествами на split/join: фазы не настраиваются. Множества —
+// уникальные ключи вставки (A) и поиска (B); каждая операция получает свежие
+// деревья, построенные вне замера. union-insert — прежний способ: вставка всех
+// ключей B в A по одному. ops — |A| + |B|
+struct AVLSets {
+    typedef avl::Node* Tree;
+    static const char* name() { return "avl-sets"; }
+    static Tree build(const std::vector<int>& keys) { return avl::Node::buildFromSorted(keys.begin(), keys.end()); }
+    static void unite(Tree& a, Tree& b) { a = avl::Node::unionOf(a, b); b = nullptr; }
+    static void intersect(Tree& a, Tree& b) { a = avl::Node::intersectionOf(a, b); b = nullptr; }
+    static void subtract(Tree& a, Tree& b) { a = avl::Node::differenceOf(a, b); b = nullptr; }
+    static void insertAll(Tree& a, const std::vector<int>& keys) {
+        for (int k : keys) {
+            if (!a->search(k)) a = a->insert(k);
+        }
+    }
+    static int height(Tree& t) { return t ? t->getHeight() : 0; }
+    static void destroy(Tree& t) { avl::Node::destroy(t); }
+};
+
+struct RBSets {
+    typedef std::unique_ptr<rb::RedBlackTree> Tree;
+    static const char* name() { return "rb-sets"; }
+    static Tree build(const std::vector<int>& keys) {
+        Tree t(new rb::RedBlackTree());
+        t->buildFromSorted(keys.begin(), keys.end());
+        return t;
+    }
+    static void unite(Tree& a, Tree& b) { a->unionWith(*b); }
+    static void intersect(Tree& a, Tree& b) { a->intersectionWith(*b); }
+    static void subtract(Tree& a, Tree& b) { a->differenceWith(*b); }
+    static void insertAll(Tree& a, const std::vector<int>& keys) {
+        for (int k : keys) {
+            if (!a->search(k)) a->insert(k);
+        }
+    }
+    static int height(Tree& t) { return t->getHeight(); }
+    static void destroy(Tree& t) { t.reset(); }
+};
+
+template <class Sets>
+void runSetOperations(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    std::vector<int> a(w.sorted);
+    a.erase(std::unique(a.begin(), a.end()), a.end());
+    std::vector<int> b(w.searches);
+    std::sort(b.begin(), b.end());
+    b.erase(std::unique(b.begin(), b.end()), b.end());
+
+    const char* phases[] = { "union", "union-insert", "intersection", "difference" };
+    for (const char* phase : phases) {
+        typename Sets::Tree ta = Sets::build(a);
+        typename Sets::Tree tb = Sets::build(b);
+        std::string p = phase;
+        PhaseResult r = timeOnce(static_cast<long long>(a.size() + b.size()), [&]() {
+            if (p == "union") Sets::unite(ta, tb);
+            else if (p == "union-insert") Sets::insertAll(ta, b);
+            else if (p == "intersection") Sets::intersect(ta, tb);
+            else Sets::subtract(ta, tb);
+        });
+        r.engine = Sets::name();
+        r.phase = phase;
+        r.n = cfg.n;
+        r.height = Sets::height(ta);
+        results.push_back(r);
+        Sets::destroy(ta);
+        Sets::destroy(tb);
+    }
+}
+
+struct AVLSnapshot {
+    typedef AVLEngine Engine;
+    static const char* name() { return "avl-snapshot"; }
+};
+
+struct RBSnapshot {
+    typedef RBEngine Engine;
+    static const char* name() { return "rb-snapshot"; }
+};
+
+// Снимок на диске против перестроения при старте. Фазы фиксированы:
+// insert — дерево из n вставок (так оно восстанавливается без снимка),
+// save — запись снимка в --snapshot, open — mmap с проверкой контрольной
+// суммы, search-mapped — поиск прямо по файлу, restore — изменяемое дерево
+// из снимка через buildFromSorted. Файл уже в страничном кэше: open мерит
+// проверку и отображение, а не чтение с диска
+template <class Snap>
+void runSnapshot(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    typedef typename Snap::Engine Engine;
+    Engine engine(cfg.pool);
+    Engine restored(cfg.pool);
+    std::unique_ptr<snapshot::MappedTree> mapped;
+    long long n = static_cast<long long>(w.inserts.size());
+
+    // Высота берётся после замера: аргументы одного вызова вычисляются в любом порядке
+    auto record = [&](PhaseResult r, const char* phase, int height) {
+        r.engine = Snap::name();
+        r.phase = phase;
+        r.n = cfg.n;
+        r.height = height;
+        results.push_back(r);
+    };
+
+    PhaseResult r = timePhase(cfg, w.inserts, [&](int k) { engine.insert(k); });
+    record(r, "insert", engine.height());
+    r = timeOnce(n, [&]() { engine.saveSnapshot(cfg.snapshot); });
+    record(r, "save", engine.height());
+    r = timeOnce(n, [&]() { mapped.reset(new snapshot::MappedTree(cfg.snapshot)); });
+    record(r, "open", mapped->height());
+
+    long long found = 0;
+    r = timePhase(cfg, w.searches, [&](int k) { found += mapped->contains(k); });
+    g_sink = g_sink + found;
+    record(r, "search-mapped", mapped->height());
+
+    r = timeOnce(n, [&]() { restored.buildFromSorted(mapped->sorted()); });
+    record(r, "restore", restored.height());
+    mapped.reset();
+    std::remove(cfg.snapshot.c_str());
+}
+
+// BST без блокировок: фазы не настраиваются. Ключи вставки, поиска и удаления
+// делятся между --threads потоками через общий счётчик, все потоки меняют
+// дерево одновременно: insert-mt, search-mt, remove-mt. ops — все операции фазы
+void runConcurrentWrites(const Config& cfg, const Workload& w, std::vector<PhaseResult>& results) {
+    lfbst::Tree tree;
+    const char* phases[] = { "insert-mt", "search-mt", "remove-mt" };
+    const std::vector<int>* keys[] = { &w.inserts, &w.searches, &w.removes };
+
+    for (int p = 0; p < 3; ++p) {
+        const std::vector<int>& phaseKeys = *keys[p];
+        std::atomic<size_t> next(0);
+        std::atomic<long long> done(0);
+        PhaseResult r = timeOnce(static_cast<long long>(phaseKeys.size()), [&]() {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < cfg.threads; ++t) {
+                workers.emplace_back([&, p]() {
+                    // Ключи разбираются кусками, чтобы счётчик не стал общей горячей линией
+                    const size_t chunk = 256;
+                    long long local = 0;
+                    for (size_t first = next.fetch_add(chunk); first < phaseKeys.size(); first = next.fetch_add(chunk)) {
+                        size_t last = std::min(phaseKeys.size(), first + chunk);
+                        for (size_t i = first; i < last; ++i) {
+                            int k = phaseKeys[i];
+                            local += p == 0 ? tree.insert(k) : p == 1 ? tree.search(k) : tree.remove(k);
+                        }
+                    }
+                    done += local;
+                });
+            }
+            for (std::thread& th : workers) th.join();
+        });
+        g_sink = g_sink + done.load();
+        r.engine = "lfbst-concurrent";
+        r.phase = phases[p];
+        r.n = cfg.n;
+        r.height = tree.height();
+        results.push_back(r);
+    }
+}
+
+// Счётчики фазы на одну операцию и IPC; nan — счётчик недоступен
+std::vector<double> countersPerOp(const PhaseResult& r) {
+    std::vector<double> values;
+    for (int c = 0; c < perf::kCounterCount; ++c) {
+        double v = r.counters.values[c];
+        values.push_back(v >= 0 && r.ops ? v / r.ops : NAN);
+    }
+    const perf::Reading& k = r.counters;
+    values.push_back(k.has(perf::CYCLES) && k.has(perf::INSTRUCTIONS) && k[perf::CYCLES] > 0
+        ? k[perf::INSTRUCTIONS] / k[perf::CYCLES] : NAN);
+    return values;
+}
+
+std::vector<std::string> counterColumns() {
+    std::vector<std::string> names;
+    for (int c = 0; c < perf::kCounterCount; ++c) names.push_back(std::string(perf::kCounterNames[c]) + "_per_op");
+    names.push_back("ipc");
+    return names;
+}
+
+// Структурные счётчики фазы (TreeStats.h): работа балансировки на операцию
+// и сравнения на поиск. Гистограмму путей целиком выводит только JSON.
+// Считают только BST.h, AVL.h и RB.h, поэтому nan — «не измерено»: у фазы
+// нет ни одного события (движок без счётчиков) или, для колонок поиска,
+// ни одного поиска
+std::vector<double> structurePerOp(const PhaseResult& r) {
+    const treestats::Counters& c = r.structure;
+    bool measured = false;
+    for (uint64_t v : c.events) measured = measured || v != 0;
+    double ops = r.ops && measured ? static_cast<double>(r.ops) : NAN;
+    double searches = c[treestats::SEARCHES] ? static_cast<double>(c[treestats::SEARCHES]) : NAN;
+    return {
+        c[treestats::ROTATIONS] / ops,
+        c[treestats::RECOLORS] / ops,
+        c[treestats::FIX_INSERT_ITERATIONS] / ops,
+        c[treestats::FIX_DELETE_ITERATIONS] / ops,
+        c[treestats::COMPARISONS] / searches,
+        std::isnan(searches) ? NAN : c.meanPath(),
+        std::isnan(searches) ? NAN : static_cast<double>(c.maxPath())
+    };
+}
+
+const char* const kStructureColumns[] = {
+    "rotations_per_op", "recolors_per_op", "fix_insert_iterations_per_op", "fix_delete_iterations_per_op",
+    "comparisons_per_search", "path_mean", "path_max"
+};
+
+void writeCsv(std::ostream& out, const std::vector<PhaseResult>& results, bool counters) {
+    out << "engine,phase,n,ops,total_ms,ns_per_op,ops_per_sec,p50_ns,p99_ns,p999_ns,height";
+    if (counters) {
+        for (const std::string& name : counterColumns()) out << ',' << name;
+    }
+    if (treestats::kEnabled) {
+        for (const char* name : kStructureColumns) out << ',' << name;
+    }
+    out << '\n';
+    for (const PhaseResult& r : results) {
+        out << r.engine << ',' << r.phase << ',' << r.n << ',' << r.ops << ','
+            << r.totalMs << ',' << r.nsPerOp << ',' << r.opsPerSec << ','
+            << r.p50 << ',' << r.p99 << ',' << r.p999 << ',' << r.height;
+        if (counters) {
+            // Недоступный счётчик — пустое поле
+            for (double v : countersPerOp(r)) {
+                out << ',';
+                if (!std::isnan(v)) out << v;
+            }
+        }
+        if (treestats::kEnabled) {
+            for (double v : structurePerOp(r)) {
+                out << ',';
+                if (!std::isnan(v)) out << v;
+            }
+        }
+        out << '\n';
+    }
+}
+
+void writeJson(std::ostream& out, const std::vector<PhaseResult>& results, bool counters) {
+    std::vector<std::string> names = counterColumns();
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PhaseResult& r = results[i];
+        out << "  {\"engine\": \"" << r.engine << "\", \"phase\": \"" << r.phase << "\""
+            << ", \"n\": " << r.n << ", \"ops\": " << r.ops
+            << ", \"total_ms\": " << r.totalMs << ", \"ns_per_op\": " << r.nsPerOp
+            << ", \"ops_per_sec\": " << r.opsPerSec
+            << ", \"p50_ns\": " << r.p50 << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999
+            << ", \"height\": " << r.height;
+        if (counters) {
+            // Недоступный счётчик — null
+            std::vector<double> values = countersPerOp(r);
+            for (size_t c = 0; c < values.size(); ++c) {
+                out << ", \"" << names[c] << "\": ";
+                if (std::isnan(values[c])) out << "null";
+                else out << values[c];
+            }
+        }
+        if (treestats::kEnabled) {
+            std::vector<double> values = structurePerOp(r);
+            for (size_t c = 0; c < values.size(); ++c) {
+                out << ", \"" << kStructureColumns[c] << "\": ";
+                if (std::isnan(values[c])) out << "null";
+                else out << values[c];
+            }
+            // paths[i] — сколько поисков прошли i узлов
+            out << ", \"path_histogram\": ";
+            if (r.structure[treestats::SEARCHES] == 0) {
+                out << "null";
+            }
+            else {
+                out << "[";
+                for (int i = 0; i <= r.structure.maxPath(); ++i) out << (i ? ", " : "") << r.structure.paths[i];
+                out << "]";
+            }
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    if (!parseArgs(argc, argv, cfg)) {
+        usage();
+        return 1;
+    }
+
+    Workload w;
+    try {
+        w = makeWorkload(cfg);
+        if (!cfg.record.empty()) recordWorkload(cfg, w);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        return 1;
+    }
+    std::unique_ptr<perf::Counters> counters;
+    if (cfg.perf) {
+        // Без счётчиков бенчмарк работает как обычно, колонки остаются пустыми
+        counters.reset(new perf::Counters());
+        if (!counters->available()) {
+            std::cerr << "Аппаратные счётчики недоступны: " << counters->error() << std::endl;
+        }
+        else if (!counters->error().empty()) {
+            std::cerr << "Не все аппаратные счётчики доступны: " << counters->error() << std::endl;
+        }
+        g_counters = counters.get();
+    }
+    std::vector<PhaseResult> results;
+
+    for (const std::string& e : cfg.engines) {
+        if (e == "bst") {
+            runEngine<BSTEngine>(cfg, w, results);
+        }
+        else if (e == "avl") {
+            runEngine<AVLEngine>(cfg, w, results);
+        }
+        else if (e == "rb") {
+            runEngine<RBEngine>(cfg, w, results);
+        }
+        else if (e == "bptree") {
+            runEngine<BPlusTreeEngine>(cfg, w, results);
+        }
+        else if (e == "avl-compact") {
+            runEngine<CompactAVLEngine>(cfg, w, results);
+        }
+        else if (e == "rb-compact") {
+            runEngine<CompactRBEngine>(cfg, w, results);
+        }
+        else if (e == "bst-multiset") {
+            runEngine<BSTMultisetEngine>(cfg, w, results);
+        }
+        else if (e == "avl-multiset") {
+            runEngine<AVLMultisetEngine>(cfg, w, results);
+        }
+        else if (e == "rb-multiset") {
+            runEngine<RBMultisetEngine>(cfg, w, results);
+        }
+        else if (e == "sharded-avl") {
+            runSharded<AVLEngine>(cfg, w, results);
+        }
+        else if (e == "sharded-rb") {
+            runSharded<RBEngine>(cfg, w, results);
+        }
+        else if (e == "avl-sets") {
+            runSetOperations<AVLSets>(cfg, w, results);
+        }
+        else if (e == "rb-sets") {
+            runSetOperations<RBSets>(cfg, w, results);
+        }
+        else if (e == "avl-snapshot") {
+            runSnapshot<AVLSnapshot>(cfg, w, results);
+        }
+        else if (e == "rb-snapshot") {
+            runSnapshot<RBSnapshot>(cfg, w, results);
+        }
+        else if (e == "lfbst") {
+            runEngine<LockFreeBSTEngine>(cfg, w, results);
+        }
+        else if (e == "lfbst-concurrent") {
+            runConcurrentWrites(cfg, w, results);
+        }
+        else if (e == "rb-concurrent") {
+            runConcurrentReads<RBConcurrentReads>(cfg, w, results);
+        }
+        else if (e == "pavl") {
+            runEngine<PersistentAVLEngine>(cfg, w, results);
+        }
+        else if (e == "pavl-concurrent") {
+            runConcurrentReads<PersistentSnapshotReads>(cfg, w, results);
+        }
+        else if (e == "otree-bst") {
+            runOrderedTree<PlainBalance>(cfg, w, results);
+        }
+        else if (e == "otree-avl") {
+            runOrderedTree<AVLBalance>(cfg, w, results);
+        }
+        else if (e == "otree-rb") {
+            runOrderedTree<RedBlackBalance>(cfg, w, results);
+        }
+        else {
+            std::cerr << "Неизвестный движок: " << e << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!cfg.output.empty()) {
+        file.open(cfg.output);
+        if (!file) {
+            std::cerr << "Ошибка открытия файла для записи результатов." << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = cfg.output.empty() ? std::cout : file;
+
+    if (cfg.format == "json") {
+        writeJson(out, results, cfg.perf);
+    }
+    else {
+        writeCsv(out, results, cfg.perf);
+    }
+    return 0;
+}
@@ -0,0 +1,552 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "FrozenTree.h"
+
+namespace compact {
+
+// Компактные AVL и красно-чёрное деревья для очень больших наборов ключей.
+// Узлы лежат в одном массиве и ссылаются друг на друга 32-битными индексами,
+// а баланс AVL-узла (-1, 0, +1) или цвет красно-чёрного хранятся в двух
+// старших битах индекса левого потомка. Узел — 12 байт (значение и два
+// индекса) против 56–64 байт у avl::Node и rb::Node с указателями, высотой
+// и сводкой поддерева, поэтому в кэш попадает в несколько раз больше дерева.
+//
+// Сводок поддеревьев (rank, select) и указателя на родителя здесь нет:
+// повороты и подъём к корню делаются на обратном ходе рекурсии.
+
+typedef uint32_t Index;
+
+const Index kNil = 0;                     // Индекс 0 — пустой потомок
+const int kTagShift = 30;
+const uint32_t kIndexMask = (1u << kTagShift) - 1;
+const Index kMaxNodes = kIndexMask;       // До ~10^9 узлов
+
+struct Node {
+    int value;
+    uint32_t links[2];  // Левый потомок с двумя битами метки (баланс или цвет), правый
+};
+
+// Массив узлов с освобождёнными ячейками в списке свободных (через правую ссылку)
+class NodeArray {
+public:
+    NodeArray() : nodes(1, Node{ 0, { kNil, kNil } }), freeList(kNil) {}
+
+    Index allocate(int value, uint32_t tag) {
+        Index i = freeList;
+        if (i != kNil) {
+            freeList = nodes[i].links[1];
+        }
+        else {
+            if (nodes.size() > kMaxNodes) {
+                throw std::length_error("compact: слишком много узлов");
+            }
+            i = static_cast<Index>(nodes.size());
+            nodes.push_back(Node());
+        }
+        nodes[i] = Node{ value, { tag << kTagShift, kNil } };
+        return i;
+    }
+
+    void release(Index i) {
+        nodes[i].links[1] = freeList;
+        freeList = i;
+    }
+
+    void clear() {
+        nodes.resize(1);
+        freeList = kNil;
+    }
+
+    void reserve(size_t n) {
+        nodes.reserve(n + 1);
+    }
+
+    size_t bytesReserved() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+
+    int value(Index i) const { return nodes[i].value; }
+    void setValue(Index i, int v) { nodes[i].value = v; }
+    Index left(Index i) const { return nodes[i].links[0] & kIndexMask; }
+    Index right(Index i) const { return nodes[i].links[1]; }
+    uint32_t tag(Index i) const { return nodes[i].links[0] >> kTagShift; }
+
+    // Потомок по направлению без перехода: обе ссылки читаются вместе со
+    // значением, выбор — по маске. При случайных ключах переход на спуске
+    // угадывается лишь в половине случаев, а тернарный оператор компилятор
+    // здесь превращает именно в переход
+    Index child(Index i, bool right) const {
+        Index l = nodes[i].links[0] & kIndexMask;
+        Index r = nodes[i].links[1];
+        Index mask = 0 - static_cast<Index>(right);
+        return (r & mask) | (l & ~mask);
+    }
+
+    void setLeft(Index i, Index child) { nodes[i].links[0] = (nodes[i].links[0] & ~kIndexMask) | child; }
+    void setRight(Index i, Index child) { nodes[i].links[1] = child; }
+    void setTag(Index i, uint32_t t) { nodes[i].links[0] = (nodes[i].links[0] & kIndexMask) | (t << kTagShift); }
+
+private:
+    std::vector<Node> nodes;
+    Index freeList;
+};
+
+// Общее у обоих деревьев: поиск, обход, построение снимка
+class TreeBase {
+public:
+    TreeBase() : root(kNil), count(0) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t bytesReserved() const {
+        return nodes.bytesReserved();
+    }
+
+    bool search(int key) const {
+        Index current = root;
+        while (current != kNil) {
+            int v = nodes.value(current);
+            if (v == key) {
+                return true;
+            }
+            current = nodes.child(current, key > v);
+        }
+        return false;
+    }
+
+    // Значения из [lo, hi] по возрастанию; стек вместо рекурсии
+    template <class Visit>
+    void scan(int lo, int hi, Visit visit) const {
+        std::vector<Index> stack;
+        Index current = root;
+        while (current != kNil || !stack.empty()) {
+            while (current != kNil) {
+                // Левое поддерево нужно, только если в нём могут быть значения >= lo
+                stack.push_back(current);
+                current = nodes.value(current) >= lo ? nodes.left(current) : kNil;
+            }
+            current = stack.back();
+            stack.pop_back();
+            int v = nodes.value(current);
+            if (v > hi) {
+                return;
+            }
+            if (v >= lo) visit(v);
+            current = nodes.right(current);
+        }
+    }
+
+    FrozenTree freeze() const {
+        std::vector<int> sorted;
+        sorted.reserve(count);
+        scan(INT_MIN, INT_MAX, [&sorted](int v) { sorted.push_back(v); });
+        return FrozenTree(sorted);
+    }
+
+    void clear() {
+        nodes.clear();
+        root = kNil;
+        count = 0;
+    }
+
+protected:
+    NodeArray nodes;
+    Index root;
+    size_t count;
+};
+
+// AVL-дерево с балансом в двух битах: 0, 1, 2 означают -1, 0, +1
+// (высота левого поддерева минус высота правого). Вставка и удаление
+// рекурсивны, на обратном ходе баланс пересчитывается по тому, выросло
+// ли (или уменьшилось) поддерево; высота дерева — O(log n), стек мал.
+// Равные значения идут в правое поддерево, как в avl::Node
+class AVLTree : public TreeBase {
+public:
+    void insert(int key) {
+        bool grew = false;
+        root = insert(root, key, grew);
+        ++count;
+    }
+
+    // Удаляет одно вхождение key
+    void remove(int key) {
+        if (!search(key)) {
+            return;
+        }
+        bool shrunk = false;
+        root = remove(root, key, shrunk);
+        --count;
+    }
+
+    // Высота по балансам: спуск всегда в более высокое поддерево, O(log n)
+    int height() const {
+        int h = 0;
+        for (Index current = root; current != kNil; ++h) {
+            current = balance(current) < 0 ? nodes.right(current) : nodes.left(current);
+        }
+        return h;
+    }
+
+    // Сбалансированное дерево из отсортированных ключей за O(n)
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        nodes.reserve(keys.size());
+        int h = 0;
+        root = build(keys.data(), keys.size(), h);
+        count = keys.size();
+    }
+
+private:
+    int balance(Index i) const {
+        return static_cast<int>(nodes.tag(i)) - 1;
+    }
+
+    void setBalance(Index i, int b) {
+        nodes.setTag(i, static_cast<uint32_t>(b + 1));
+    }
+
+    Index build(const int* keys, size_t n, int& h) {
+        if (n == 0) {
+            h = 0;
+            return kNil;
+        }
+        size_t mid = n / 2;
+        int hl, hr;
+        Index l = build(keys, mid, hl);
+        Index r = build(keys + mid + 1, n - mid - 1, hr);
+        Index node = nodes.allocate(keys[mid], 1);
+        nodes.setLeft(node, l);
+        nodes.setRight(node, r);
+        setBalance(node, hl - hr);
+        h = 1 + std::max(hl, hr);
+        return node;
+    }
+
+    // Одиночные повороты с пересчётом балансов; b — баланс x до поворота (±2)
+    Index rotateRight(Index x, int b) {
+        Index y = nodes.left(x);
+        int by = balance(y);
+        nodes.setLeft(x, nodes.right(y));
+        nodes.setRight(y, x);
+        int nx = b - 1 - std::max(by, 0);
+        setBalance(x, nx);
+        setBalance(y, by - 1 + std::min(nx, 0));
+        return y;
+    }
+
+    Index rotateLeft(Index x, int b) {
+        Index y = nodes.right(x);
+        int by = balance(y);
+        nodes.setRight(x, nodes.left(y));
+        nodes.setLeft(y, x);
+        int nx = b + 1 - std::min(by, 0);
+        setBalance(x, nx);
+        setBalance(y, by + 1 + std::max(nx, 0));
+        return y;
+    }
+
+    // Узел с балансом b (от -2 до 2); при ±2 поворот, возвращает корень поддерева
+    Index rebalance(Index x, int b) {
+        if (b == 2) {
+            Index y = nodes.left(x);
+            if (balance(y) >= 0) {
+                return rotateRight(x, b);
+            }
+            // Левый правый случай: внук z поднимается наверх
+            Index z = nodes.right(y);
+            int bz = balance(z);
+            nodes.setRight(y, nodes.left(z));
+            nodes.setLeft(x, nodes.right(z));
+            nodes.setLeft(z, y);
+            nodes.setRight(z, x);
+            setBalance(x, bz == 1 ? -1 : 0);
+            setBalance(y, bz == -1 ? 1 : 0);
+            setBalance(z, 0);
+            return z;
+        }
+        if (b == -2) {
+            Index y = nodes.right(x);
+            if (balance(y) <= 0) {
+                return rotateLeft(x, b);
+            }
+            // Правый левый случай
+            Index z = nodes.left(y);
+            int bz = balance(z);
+            nodes.setLeft(y, nodes.right(z));
+            nodes.setRight(x, nodes.left(z));
+            nodes.setLeft(z, x);
+            nodes.setRight(z, y);
+            setBalance(x, bz == -1 ? 1 : 0);
+            setBalance(y, bz == 1 ? -1 : 0);
+            setBalance(z, 0);
+            return z;
+        }
+        setBalance(x, b);
+        return x;
+    }
+
+    Index insert(Index node, int key, bool& grew) {
+        if (node == kNil) {
+            grew = true;
+            return nodes.allocate(key, 1);
+        }
+        int b = balance(node);
+        if (key < nodes.value(node)) {
+            Index child = insert(nodes.left(node), key, grew);
+            nodes.setLeft(node, child);
+            if (grew) ++b;
+        }
+        else {
+            Index child = insert(nodes.right(node), key, grew);
+            nodes.setRight(node, child);
+            if (grew) --b;
+        }
+        if (!grew) {
+            return node;
+        }
+        // Поддерево выросло, только если баланс ушёл из нуля
+        grew = b == 1 || b == -1;
+        return rebalance(node, b);
+    }
+
+    Index remove(Index node, int key, bool& shrunk) {
+        int b = balance(node);
+        int v = nodes.value(node);
+        if (key < v) {
+            nodes.setLeft(node, remove(nodes.left(node), key, shrunk));
+            if (shrunk) --b;
+        }
+        else if (key > v) {
+            nodes.setRight(node, remove(nodes.right(node), key, shrunk));
+            if (shrunk) ++b;
+        }
+        else {
+            Index l = nodes.left(node);
+            Index r = nodes.right(node);
+            if (l == kNil || r == kNil) {
+                nodes.release(node);
+                shrunk = true;
+                return l != kNil ? l : r;
+            }
+            // Место узла занимает наименьшее значение правого поддерева
+            int minValue = 0;
+            nodes.setRight(node, removeMin(r, minValue, shrunk));
+            nodes.setValue(node, minValue);
+            if (shrunk) ++b;
+        }
+        if (!shrunk) {
+            return node;
+        }
+        Index top = rebalance(node, b);
+        // Поддерево уменьшилось, если баланс вернулся к нулю
+        shrunk = balance(top) == 0;
+        return top;
+    }
+
+    Index removeMin(Index node, int& minValue, bool& shrunk) {
+        Index l = nodes.left(node);
+        if (l == kNil) {
+            minValue = nodes.value(node);
+            Index r = nodes.right(node);
+            nodes.release(node);
+            shrunk = true;
+            return r;
+        }
+        int b = balance(node);
+        nodes.setLeft(node, removeMin(l, minValue, shrunk));
+        if (!shrunk) {
+            return node;
+        }
+        Index top = rebalance(node, b - 1);
+        shrunk = balance(top) == 0;
+        return top;
+    }
+};
+
+// Левостороннее красно-чёрное дерево (LLRB, Sedgewick, 2008): красный узел
+// бывает только левым потомком, поэтому вставка и удаление укладываются
+// в рекурсию с тремя локальными правками на обратном ходе (fixUp) и не
+// требуют указателя на родителя. Цвет — старший бит индекса левого потомка.
+// Равные значения идут в правое поддерево
+class RedBlackTree : public TreeBase {
+public:
+    void insert(int key) {
+        root = insert(root, key);
+        nodes.setTag(root, kBlack);
+        ++count;
+    }
+
+    // Удаляет одно вхождение key
+    void remove(int key) {
+        if (!search(key)) {
+            return;
+        }
+        if (!isRed(nodes.left(root)) && !isRed(nodes.right(root))) {
+            nodes.setTag(root, kRed);
+        }
+        root = remove(root, key);
+        if (root != kNil) nodes.setTag(root, kBlack);
+        --count;
+    }
+
+    // Высота хранится только неявно: обход всех узлов, O(n)
+    int height() const {
+        int h = 0;
+        std::vector<std::pair<Index, int>> stack;
+        if (root != kNil) stack.push_back(std::make_pair(root, 1));
+        while (!stack.empty()) {
+            Index node = stack.back().first;
+            int depth = stack.back().second;
+            stack.pop_back();
+            h = std::max(h, depth);
+            if (nodes.left(node) != kNil) stack.push_back(std::make_pair(nodes.left(node), depth + 1));
+            if (nodes.right(node) != kNil) stack.push_back(std::make_pair(nodes.right(node), depth + 1));
+        }
+        return h;
+    }
+
+    // В LLRB красные узлы нижнего неполного уровня должны быть левыми
+    // потомками, и готовая раскладка rb::RedBlackTree не подходит: вставляем
+    // по порядку, O(n log n), но путь всё время один и тот же и лежит в кэше
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        nodes.reserve(keys.size());
+        for (int k : keys) insert(k);
+    }
+
+private:
+    static const uint32_t kBlack = 0;
+    static const uint32_t kRed = 1;
+
+    bool isRed(Index i) const {
+        return i != kNil && nodes.tag(i) == kRed;
+    }
+
+    void flipColors(Index h) {
+        nodes.setTag(h, nodes.tag(h) ^ 1);
+        nodes.setTag(nodes.left(h), nodes.tag(nodes.left(h)) ^ 1);
+        nodes.setTag(nodes.right(h), nodes.tag(nodes.right(h)) ^ 1);
+    }
+
+    Index rotateLeft(Index h) {
+        Index x = nodes.right(h);
+        nodes.setRight(h, nodes.left(x));
+        nodes.setLeft(x, h);
+        nodes.setTag(x, nodes.tag(h));
+        nodes.setTag(h, kRed);
+        return x;
+    }
+
+    Index rotateRight(Index h) {
+        Index x = nodes.left(h);
+        nodes.setLeft(h, nodes.right(x));
+        nodes.setRight(x, h);
+        nodes.setTag(x, nodes.tag(h));
+        nodes.setTag(h, kRed);
+        return x;
+    }
+
+    // Восстанавливает левосторонность на обратном ходе
+    Index fixUp(Index h) {
+        if (isRed(nodes.right(h)) && !isRed(nodes.left(h))) h = rotateLeft(h);
+        if (isRed(nodes.left(h)) && isRed(nodes.left(nodes.left(h)))) h = rotateRight(h);
+        if (isRed(nodes.left(h)) && isRed(nodes.right(h))) flipColors(h);
+        return h;
+    }
+
+    // Делает красным левого потомка или его левого потомка перед спуском влево
+    Index moveRedLeft(Index h) {
+        flipColors(h);
+        if (isRed(nodes.left(nodes.right(h)))) {
+            nodes.setRight(h, rotateRight(nodes.right(h)));
+            h = rotateLeft(h);
+            flipColors(h);
+        }
+        return h;
+    }
+
+    Index moveRedRight(Index h) {
+        flipColors(h);
+        if (isRed(nodes.left(nodes.left(h)))) {
+            h = rotateRight(h);
+            flipColors(h);
+        }
+        return h;
+    }
+
+    Index insert(Index h, int key) {
+        if (h == kNil) {
+            return nodes.allocate(key, kRed);
+        }
+        if (key < nodes.value(h)) {
+            Index child = insert(nodes.left(h), key);
+            nodes.setLeft(h, child);
+        }
+        else {
+            Index child = insert(nodes.right(h), key);
+            nodes.setRight(h, child);
+        }
+        return fixUp(h);
+    }
+
+    Index removeMin(Index h, int& minValue) {
+        if (nodes.left(h) == kNil) {
+            minValue = nodes.value(h);
+            nodes.release(h);
+            return kNil;
+        }
+        if (!isRed(nodes.left(h)) && !isRed(nodes.left(nodes.left(h)))) {
+            h = moveRedLeft(h);
+        }
+        nodes.setLeft(h, removeMin(nodes.left(h), minValue));
+        return fixUp(h);
+    }
+
+    // key точно есть в поддереве h
+    Index remove(Index h, int key) {
+        if (key < nodes.value(h)) {
+            if (!isRed(nodes.left(h)) && !isRed(nodes.left(nodes.left(h)))) {
+                h = moveRedLeft(h);
+            }
+            nodes.setLeft(h, remove(nodes.left(h), key));
+        }
+        else {
+            if (isRed(nodes.left(h))) {
+                h = rotateRight(h);
+            }
+            if (key == nodes.value(h) && nodes.right(h) == kNil) {
+                nodes.release(h);
+                return kNil;
+            }
+            bool rotated = false;
+            if (!isRed(nodes.right(h)) && !isRed(nodes.left(nodes.right(h)))) {
+                Index before = h;
+                h = moveRedRight(h);
+                rotated = h != before;
+            }
+            // После поворота наверху левый потомок: при повторах его значение
+            // может быть равно key, но удаляемое вхождение уже справа
+            if (!rotated && key == nodes.value(h)) {
+                int minValue = 0;
+                nodes.setRight(h, removeMin(nodes.right(h), minValue));
+                nodes.setValue(h, minValue);
+            }
+            else {
+                nodes.setRight(h, remove(nodes.right(h), key));
+            }
+        }
+        return fixUp(h);
+    }
+};
+
+} // namespace compact
@@ -0,0 +1,535 @@
+#pragma once
+
+#include "BST.h"
+#include "AVL.h"
+#include "RB.h"
+#include "BPlusTree.h"
+#include "CompactTree.h"
+#include "LockFreeBST.h"
+#include "NodePool.h"
+#include "OrderedTree.h"
+#include "PersistentAVL.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Единый интерфейс над тремя деревьями для бенчмарка:
+// insert / search / searchBatch / remove / scan / height / clear / freeze. Каждый прогон создаёт новый движок,
+// память освобождается в деструкторе. С usePool узлы берутся из NodePool,
+// а clear() освобождает их разом.
+
+class BSTEngine {
+public:
+    typedef NodePool<bst::Node> Pool;
+
+    explicit BSTEngine(bool usePool = false) : root(nullptr), pool(usePool ? new Pool() : nullptr) {}
+    ~BSTEngine() { clear(); }
+
+    static const char* name() { return "bst"; }
+
+    void insert(int key) {
+        Pool::Scope scope(pool.get());
+        if (root == nullptr) {
+            root = new bst::Node(key);
+        }
+        else {
+            root->insert(key);
+        }
+    }
+
+    void insertCounted(int key) {
+        Pool::Scope scope(pool.get());
+        if (root == nullptr) {
+            root = new bst::Node(key);
+        }
+        else {
+            root->insertCounted(key);
+        }
+    }
+
+    bool search(int key) {
+        return root && root->search(key);
+    }
+
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        if (root) {
+            root->searchBatch(keys, n, results);
+        }
+        else {
+            std::fill(results, results + n, false);
+        }
+    }
+
+    void remove(int key) {
+        Pool::Scope scope(pool.get());
+        if (root) root = root->remove(key);
+    }
+
+    // Число ключей в [lo, hi]; ключи обходятся по одному, как при настоящем скане
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        if (root) root->scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    int height() {
+        return root ? root->height() : 0;
+    }
+
+    FrozenTree freeze() {
+        return root ? root->freeze() : FrozenTree(std::vector<int>());
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        Pool::Scope scope(pool.get());
+        root = bst::Node::buildFromSorted(keys.begin(), keys.end());
+    }
+
+    void insertBatch(const std::vector<int>& keys) {
+        Pool::Scope scope(pool.get());
+        root = bst::Node::insertBatch(root, keys);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        Pool::Scope scope(pool.get());
+        root = bst::Node::removeBatch(root, keys);
+    }
+
+    void clear() {
+        if (pool) {
+            pool->release();
+        }
+        else {
+            bst::Node::destroy(root);
+        }
+        root = nullptr;
+    }
+
+private:
+    bst::Node* root;
+    std::unique_ptr<Pool> pool;
+
+    BSTEngine(const BSTEngine&) = delete;
+    BSTEngine& operator=(const BSTEngine&) = delete;
+};
+
+class AVLEngine {
+public:
+    typedef NodePool<avl::Node> Pool;
+
+    explicit AVLEngine(bool usePool = false) : root(nullptr), pool(usePool ? new Pool() : nullptr) {}
+    ~AVLEngine() { clear(); }
+
+    static const char* name() { return "avl"; }
+
+    void insert(int key) {
+        Pool::Scope scope(pool.get());
+        root = root ? root->insert(key) : new avl::Node(key);
+    }
+
+    void insertCounted(int key) {
+        Pool::Scope scope(pool.get());
+        root = root ? root->insertCounted(key) : new avl::Node(key);
+    }
+
+    bool search(int key) {
+        return root && root->search(key);
+    }
+
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        if (root) {
+            root->searchBatch(keys, n, results);
+        }
+        else {
+            std::fill(results, results + n, false);
+        }
+    }
+
+    void remove(int key) {
+        Pool::Scope scope(pool.get());
+        if (root) root = root->remove(key);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        if (root) root->scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    template <class Visit>
+    void forEachInRange(int lo, int hi, Visit visit) {
+        if (root) root->scan(lo, hi, visit);
+    }
+
+    int height() {
+        return root ? root->getHeight() : 0;
+    }
+
+    FrozenTree freeze() {
+        return root ? root->freeze() : FrozenTree(std::vector<int>());
+    }
+
+    // Снимок на диск для быстрого старта (Snapshot.h)
+    void saveSnapshot(const std::string& path) {
+        snapshot::write(path, root);
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        Pool::Scope scope(pool.get());
+        root = avl::Node::buildFromSorted(keys.begin(), keys.end());
+    }
+
+    void insertBatch(const std::vector<int>& keys) {
+        Pool::Scope scope(pool.get());
+        root = avl::Node::insertBatch(root, keys);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        Pool::Scope scope(pool.get());
+        root = avl::Node::removeBatch(root, keys);
+    }
+
+    void clear() {
+        if (pool) {
+            pool->release();
+        }
+        else {
+            avl::Node::destroy(root);
+        }
+        root = nullptr;
+    }
+
+private:
+    avl::Node* root;
+    std::unique_ptr<Pool> pool;
+
+    AVLEngine(const AVLEngine&) = delete;
+    AVLEngine& operator=(const AVLEngine&) = delete;
+};
+
+class RBEngine {
+public:
+    explicit RBEngine(bool usePool = false) : pool(usePool ? new rb::RedBlackTree::Pool() : nullptr), tree(pool.get()) {}
+
+    static const char* name() { return "rb"; }
+
+    void insert(int key) { tree.insert(key); }
+    void insertCounted(int key) { tree.insertCounted(key); }
+    bool search(int key) { return tree.search(key) != nullptr; }
+    void searchBatch(const int* keys, size_t n, bool* results) { tree.searchBatch(keys, n, results); }
+    void remove(int key) { tree.erase(key); }
+    int height() { return tree.getHeight(); }
+    FrozenTree freeze() { return tree.freeze(); }
+    void saveSnapshot(const std::string& path) { snapshot::write(path, tree); }
+
+    template <class Visit>
+    void forEachInRange(int lo, int hi, Visit visit) {
+        tree.scan(lo, hi, visit);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        tree.buildFromSorted(keys.begin(), keys.end());
+    }
+
+    void insertBatch(const std::vector<int>& keys) { tree.insertBatch(keys); }
+    void removeBatch(const std::vector<int>& keys) { tree.deleteBatch(keys); }
+
+    void clear() {
+        tree.clear();
+        if (pool) pool->release();
+    }
+
+private:
+    std::unique_ptr<rb::RedBlackTree::Pool> pool; // Объявлен до tree: разрушается после него
+    rb::RedBlackTree tree;
+};
+
+// B+ дерево: узлы выровнены по кэш-линиям и выделяются обычным new,
+// поэтому флаг пула не используется
+class BPlusTreeEngine {
+public:
+    explicit BPlusTreeEngine(bool = false) {}
+
+    static const char* name() { return "bptree"; }
+
+    void insert(int key) { tree.insert(key); }
+    bool search(int key) { return tree.search(key); }
+    void searchBatch(const int* keys, size_t n, bool* results) { tree.searchBatch(keys, n, results); }
+    void remove(int key) { tree.remove(key); }
+    int height() { return tree.getHeight(); }
+    void clear() { tree.clear(); }
+
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        sorted.reserve(tree.size());
+        tree.scan(INT_MIN, INT_MAX, [&sorted](int k) { sorted.push_back(k); });
+        return FrozenTree(sorted);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) {
+        tree.buildFromSorted(keys.begin(), keys.end());
+    }
+
+    // Узлы B+ дерева широкие: пакет просто вставляется по одному ключу
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.insert(k);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.remove(k);
+    }
+
+private:
+    bpt::BPlusTree tree;
+};
+
+// BST без блокировок. Здесь он гоняется в один поток для сравнения
+// с остальными деревьями; многопоточные фазы — движок lfbst-concurrent в бенчмарке.
+// Узлы выделяются обычным new, флаг пула не используется
+class LockFreeBSTEngine {
+public:
+    explicit LockFreeBSTEngine(bool = false) {}
+
+    static const char* name() { return "lfbst"; }
+
+    void insert(int key) { tree.insert(key); }
+    bool search(int key) { return tree.search(key); }
+    void remove(int key) { tree.remove(key); }
+    int height() { return tree.height(); }
+    FrozenTree freeze() { return tree.freeze(); }
+    void clear() { tree.clear(); }
+
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        for (size_t i = 0; i < n; ++i) results[i] = tree.search(keys[i]);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) { tree.buildFromSorted(keys); }
+
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.insert(k);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.remove(k);
+    }
+
+private:
+    lfbst::Tree tree;
+};
+
+// Персистентное AVL-дерево: каждое изменение строит новую версию, копируя путь.
+// Движок держит только последнюю версию, старые освобождаются сразу
+class PersistentAVLEngine {
+public:
+    explicit PersistentAVLEngine(bool = false) {}
+
+    static const char* name() { return "pavl"; }
+
+    void insert(int key) { tree = tree.insert(key); }
+    bool search(int key) { return tree.contains(key); }
+    void remove(int key) { tree = tree.remove(key); }
+    int height() { return tree.height(); }
+    FrozenTree freeze() { return tree.freeze(); }
+    void clear() { tree = pavl::Version(); }
+
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        for (size_t i = 0; i < n; ++i) results[i] = tree.contains(keys[i]);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    void buildFromSorted(const std::vector<int>& keys) { tree = pavl::Version::buildFromSorted(keys); }
+
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree = tree.insert(k);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree = tree.remove(k);
+    }
+
+private:
+    pavl::Version tree;
+};
+
+// Компактные деревья (CompactTree.h): 12-байтовые узлы с 32-битными индексами
+template <class Tree> struct CompactName;
+template <> struct CompactName<compact::AVLTree> { static const char* get() { return "avl-compact"; } };
+template <> struct CompactName<compact::RedBlackTree> { static const char* get() { return "rb-compact"; } };
+
+template <class Tree>
+class CompactEngine {
+public:
+    // Узлы и так лежат в одном массиве, пул не нужен
+    explicit CompactEngine(bool = false) {}
+
+    static const char* name() { return CompactName<Tree>::get(); }
+
+    void insert(int key) { tree.insert(key); }
+    bool search(int key) { return tree.search(key); }
+    void remove(int key) { tree.remove(key); }
+    int height() { return tree.height(); }
+    FrozenTree freeze() { return tree.freeze(); }
+    void clear() { tree.clear(); }
+
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        for (size_t i = 0; i < n; ++i) results[i] = tree.search(keys[i]);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.scan(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    template <class Visit>
+    void forEachInRange(int lo, int hi, Visit visit) { tree.scan(lo, hi, visit); }
+
+    void buildFromSorted(const std::vector<int>& keys) { tree.buildFromSorted(keys); }
+
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.insert(k);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.remove(k);
+    }
+
+private:
+    Tree tree;
+};
+
+typedef CompactEngine<compact::AVLTree> CompactAVLEngine;
+typedef CompactEngine<compact::RedBlackTree> CompactRBEngine;
+
+// Режим мультимножества: повтор ключа увеличивает кратность узла (insertCounted)
+// вместо нового узла. На перекошенных потоках ключей (zipfian) горячие
+// повторы не выделяют память и не балансируют дерево. Остальное — как у Engine
+template <class Engine> struct MultisetName;
+template <> struct MultisetName<BSTEngine> { static const char* get() { return "bst-multiset"; } };
+template <> struct MultisetName<AVLEngine> { static const char* get() { return "avl-multiset"; } };
+template <> struct MultisetName<RBEngine> { static const char* get() { return "rb-multiset"; } };
+
+template <class Engine>
+class MultisetEngine : public Engine {
+public:
+    explicit MultisetEngine(bool usePool = false) : Engine(usePool) {}
+
+    static const char* name() { return MultisetName<Engine>::get(); }
+
+    void insert(int key) { Engine::insertCounted(key); }
+
+    // Пакет вставляется по одному ключу: слияние пакета с деревом создало бы
+    // узел на каждый повтор
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) Engine::insertCounted(k);
+    }
+
+    // Дерево строится из различных ключей, повторы добавляют кратность
+    void buildFromSorted(const std::vector<int>& keys) {
+        std::vector<int> distinct;
+        std::vector<int> repeats;
+        distinct.reserve(keys.size());
+        for (int k : keys) {
+            if (!distinct.empty() && distinct.back() == k) {
+                repeats.push_back(k);
+            }
+            else {
+                distinct.push_back(k);
+            }
+        }
+        Engine::buildFromSorted(distinct);
+        for (int k : repeats) Engine::insertCounted(k);
+    }
+};
+
+typedef MultisetEngine<BSTEngine> BSTMultisetEngine;
+typedef MultisetEngine<AVLEngine> AVLMultisetEngine;
+typedef MultisetEngine<RBEngine> RBMultisetEngine;
+
+// Обобщённое OrderedTree<int, int> с заданной политикой балансировки.
+// Ключи уникальны, поэтому повторная вставка ключа узел не добавляет.
+template <class Policy> struct OrderedTreeName;
+template <> struct OrderedTreeName<PlainBalance> { static const char* get() { return "otree-bst"; } };
+template <> struct OrderedTreeName<AVLBalance> { static const char* get() { return "otree-avl"; } };
+template <> struct OrderedTreeName<RedBlackBalance> { static const char* get() { return "otree-rb"; } };
+
+template <class Policy, class Allocator = std::allocator<std::pair<const int, int>>>
+class OrderedTreeEngine {
+public:
+    // Пул задаётся параметром Allocator (PoolAllocator), флаг оставлен для единообразия
+    explicit OrderedTreeEngine(bool = false) {}
+
+    static const char* name() { return OrderedTreeName<Policy>::get(); }
+
+    void insert(int key) { tree.insert(key, key); }
+    bool search(int key) { return tree.contains(key); }
+
+    // У OrderedTree нет пакетного поиска: ищем по одному
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        for (size_t i = 0; i < n; ++i) results[i] = tree.contains(keys[i]);
+    }
+    void remove(int key) { tree.erase(key); }
+    int height() { return tree.height(); }
+
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        sorted.reserve(tree.size());
+        tree.forEach([&sorted](const int& k, const int&) { sorted.push_back(k); });
+        return FrozenTree(sorted);
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        tree.forEachInRange(lo, hi, [&visited](const int&, const int&) { ++visited; });
+        return visited;
+    }
+    void clear() { tree.clear(); }
+
+    // У OrderedTree нет линейного построения: вставляем по одному
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        for (int k : keys) tree.insert(k, k);
+    }
+
+    void insertBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.insert(k, k);
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        for (int k : keys) tree.erase(k);
+    }
+
+private:
+    OrderedTree<int, int, std::less<int>, Policy, Allocator> tree;
+};
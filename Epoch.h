@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Освобождение памяти по эпохам (epoch-based reclamation) для структур,
+// которые читают без блокировок.
+//
+// Читатель на время операции держит Guard: в слот его потока записывается
+// текущая эпоха. Писатель не удаляет исключённый из структуры узел сразу,
+// а откладывает его (retire) с номером эпохи. collect() продвигает эпоху
+// и удаляет узлы, отложенные раньше самой старой эпохи активных читателей:
+// ни один читатель уже не может держать на них указатель.
+//
+// Отложенные узлы лежат в списке потока, который их отложил, и только этот
+// поток их и удаляет, поэтому Guard, retire и collect можно вызывать из любых
+// потоков без блокировок. Список завершившегося потока достаётся следующему
+// потоку с тем же номером или удаляется вместе с доменом.
+
+// Номер потока для слотов EpochDomain: выдаётся при первом обращении
+// и возвращается в общий список при завершении потока
+class EpochThreadId {
+public:
+    static const int kMaxThreads = 128;
+
+    static int get() {
+        thread_local EpochThreadId id;
+        return id.index;
+    }
+
+private:
+    int index;
+
+    EpochThreadId() : index(-1) {
+        for (int i = 0; i < kMaxThreads; ++i) {
+            bool expected = false;
+            if (used()[i].compare_exchange_strong(expected, true)) {
+                index = i;
+                return;
+            }
+        }
+        throw std::runtime_error("EpochThreadId: слишком много потоков");
+    }
+
+    ~EpochThreadId() {
+        used()[index].store(false);
+    }
+
+    static std::atomic<bool>* used() {
+        static std::atomic<bool> slots[kMaxThreads];
+        return slots;
+    }
+};
+
+class EpochDomain {
+public:
+    typedef void (*Deleter)(void* object, void* context);
+
+    EpochDomain() : epoch(1) {
+        for (Slot& slot : slots) slot.epoch.store(kIdle);
+    }
+
+    ~EpochDomain() {
+        drain();
+    }
+
+    // Защита читателя: пока Guard жив, узлы, которые поток мог увидеть, не удаляются.
+    // Вложенные Guard в одном потоке не поддерживаются
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& d) : domain(d), slot(d.slots[EpochThreadId::get()].epoch) {
+            slot.store(domain.epoch.load());
+        }
+
+        ~Guard() {
+            slot.store(kIdle, std::memory_order_release);
+        }
+
+    private:
+        EpochDomain& domain;
+        std::atomic<uint64_t>& slot;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // Откладывает удаление объекта, уже недоступного новым читателям,
+    // в список вызывающего потока
+    void retire(void* object, Deleter deleter, void* context) {
+        Limbo& own = limbo[EpochThreadId::get()];
+        own.retired.push_back(Retired{ object, deleter, context, epoch.load() });
+        if (++own.sinceCollect >= kCollectEvery) {
+            collect(own);
+        }
+    }
+
+    // Продвигает эпоху и удаляет из списка вызывающего потока то, что
+    // отложено до самой старой активной эпохи
+    void collect() {
+        collect(limbo[EpochThreadId::get()]);
+    }
+
+    // Удаляет отложенное всеми потоками: только когда домен никто не использует
+    void drain() {
+        for (Limbo& l : limbo) {
+            for (const Retired& r : l.retired) r.deleter(r.object, r.context);
+            l.retired.clear();
+            l.sinceCollect = 0;
+        }
+    }
+
+    // Сколько объектов ждёт удаления; точно, только когда домен никто не использует
+    size_t pending() const {
+        size_t total = 0;
+        for (const Limbo& l : limbo) total += l.retired.size();
+        return total;
+    }
+
+private:
+    static const uint64_t kIdle = UINT64_MAX;
+    static const size_t kCollectEvery = 64;
+
+    // Слот на кэш-линию, чтобы читатели разных потоков не делили линии
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;
+    };
+
+    struct Retired {
+        void* object;
+        Deleter deleter;
+        void* context;
+        uint64_t epoch;
+    };
+
+    // Отложенное одним потоком; тоже по кэш-линии, чтобы писатели не мешали друг другу
+    struct alignas(64) Limbo {
+        std::vector<Retired> retired;
+        size_t sinceCollect = 0;
+    };
+
+    std::atomic<uint64_t> epoch;
+    Slot slots[EpochThreadId::kMaxThreads];
+    Limbo limbo[EpochThreadId::kMaxThreads];   // Список потока трогает только он сам
+
+    void collect(Limbo& own) {
+        own.sinceCollect = 0;
+        uint64_t oldest = epoch.fetch_add(1) + 1;
+        for (const Slot& slot : slots) {
+            uint64_t e = slot.epoch.load();
+            if (e < oldest) oldest = e;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < own.retired.size(); ++i) {
+            if (own.retired[i].epoch < oldest) {
+                own.retired[i].deleter(own.retired[i].object, own.retired[i].context);
+            }
+            else {
+                own.retired[kept++] = own.retired[i];
+            }
+        }
+        own.retired.resize(kept);
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <thread>
+
+// Ветвление для рекурсивных алгоритмов «разделяй и властвуй» (операции над
+// множествами на split/join). Пока есть бюджет ветвлений, первая ветвь идёт
+// в новом потоке, вторая — в текущем; бюджет уменьшается с глубиной, так что
+// потоков не больше 2^budget. Мелкие подзадачи решаются без потоков: создание
+// потока стоит десятки микросекунд.
+
+const int kForkGrain = 1 << 14; // Меньше стольких узлов на обе ветви — без потока
+
+// Бюджет ветвлений: log2(число ядер) + 1, чтобы потоков было с запасом
+inline int forkBudget() {
+    unsigned cores = std::thread::hardware_concurrency();
+    int budget = 1;
+    while (cores > 1) {
+        cores >>= 1;
+        ++budget;
+    }
+    return cores == 0 ? 0 : budget;
+}
+
+template <class F, class G>
+void forkJoin(bool fork, F&& first, G&& second) {
+    if (!fork) {
+        first();
+        second();
+        return;
+    }
+    std::thread worker(first);
+    second();
+    worker.join();
+}
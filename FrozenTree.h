@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Неизменяемый снимок дерева для долгих периодов только чтения. Значения
+// лежат одним массивом в порядке Эйтцингера (обход в ширину полного дерева:
+// потомки ячейки k — 2k и 2k + 1), поэтому верхние уровни всегда в кэше,
+// а поиск — это вычисление индекса без ветвлений и без указателей.
+// Строится за O(n) из значений по возрастанию (freeze() у деревьев).
+class FrozenTree {
+public:
+    FrozenTree() : count(0) {}
+
+    // sorted — значения по возрастанию, равные допускаются
+    explicit FrozenTree(const std::vector<int>& sorted)
+        : lines((sorted.size() + kLineInts) / kLineInts), count(sorted.size()) {
+        size_t next = 0;
+        fill(sorted, next, 1);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Индекс ячейки с наименьшим значением >= key или 0, если такого нет.
+    // Каждый шаг — сравнение и сдвиг, а ячейка на четыре уровня ниже
+    // (16 int — одна кэш-линия потомков) запрашивается заранее
+    size_t lowerBoundIndex(int key) const {
+        const int* a = data();
+        size_t n = count;
+        size_t k = 1;
+        while (k <= n) {
+            __builtin_prefetch(a + 16 * k);
+            k = 2 * k + (a[k] < key);
+        }
+        // Поднимаемся из последнего поворота направо: отбрасываем хвостовые
+        // единицы и ещё один бит
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+        return k;
+    }
+
+    // Указатель на наименьшее значение >= key или nullptr
+    const int* lowerBound(int key) const {
+        size_t k = lowerBoundIndex(key);
+        return k ? data() + k : nullptr;
+    }
+
+    bool contains(int key) const {
+        size_t k = lowerBoundIndex(key);
+        return k != 0 && data()[k] == key;
+    }
+
+private:
+    static const size_t kLineInts = 16;
+
+    // Массив выровнен по кэш-линиям: 16 потомков ячейки k через четыре
+    // уровня (16k ... 16k + 15) занимают ровно одну линию
+    struct alignas(64) Line {
+        int v[kLineInts];
+    };
+
+    std::vector<Line> lines;
+    size_t count;
+
+    // Ячейки 1..count; ячейка 0 не используется
+    int* data() { return lines.empty() ? nullptr : lines[0].v; }
+    const int* data() const { return lines.empty() ? nullptr : lines[0].v; }
+
+    // Симметричный обход неявного дерева раздаёт значения по порядку
+    void fill(const std::vector<int>& sorted, size_t& next, size_t k) {
+        if (k > count) {
+            return;
+        }
+        fill(sorted, next, 2 * k);
+        data()[k] = sorted[next++];
+        fill(sorted, next, 2 * k + 1);
+    }
+};
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "Epoch.h"
+#include "FrozenTree.h"
+
+namespace lfbst {
+
+// Двоичное дерево поиска без блокировок (Natarajan, Mittal, 2014): insert,
+// search и remove можно вызывать из любого числа потоков одновременно.
+//
+// Дерево листовое: ключи множества лежат в листьях, внутренние узлы только
+// направляют поиск (ключ < key — налево, иначе направо), у каждого ровно два
+// потомка. Вставка заменяет лист внутренним узлом с двумя листьями — один CAS.
+// Удаление помечает ребро к листу флагом (с этого момента ключ удалён),
+// затем ставит тег на ребро к брату, чтобы его больше никто не менял, и одним
+// CAS поднимает брата на место родителя. Операция, наткнувшаяся на помеченное
+// ребро, сама доводит чужое удаление до конца, так что никто никого не ждёт.
+//
+// Флаг и тег хранятся в младших битах указателя на потомка. Сверху стоят
+// три узла-ограничителя с ключами больше любого int, поэтому у настоящих
+// листьев всегда есть родитель и дед.
+//
+// Память: отсоединённые узлы откладываются в EpochDomain, каждая операция
+// держит Guard. В отличие от BST.h ключи не повторяются: insert существующего
+// ключа ничего не делает.
+class Tree {
+public:
+    Tree() {
+        root = new Node(kInf2, new Node(kInf1, new Node(kInf0), new Node(kInf1)), new Node(kInf2));
+        sentinel = address(root->left.load());
+    }
+
+    ~Tree() {
+        destroy(root);
+    }
+
+    bool insert(int key) {
+        EpochDomain::Guard guard(epochs);
+        Node* newLeaf = nullptr;
+        Node* newInternal = nullptr;
+        SeekRecord s;
+        while (true) {
+            seek(key, s);
+            Node* leaf = s.leaf;
+            if (leaf->key == key) {
+                delete newInternal;
+                delete newLeaf;
+                return false;
+            }
+            std::atomic<uintptr_t>& child = key < s.parent->key ? s.parent->left : s.parent->right;
+            if (newLeaf == nullptr) {
+                newLeaf = new Node(key);
+                newInternal = new Node(0, nullptr, nullptr);
+            }
+            // Внутренний узел с ключом большего из двух листьев, меньший — слева
+            bool leafFirst = leaf->key < key;
+            newInternal->key = leafFirst ? key : leaf->key;
+            newInternal->left.store(pack(leafFirst ? leaf : newLeaf), std::memory_order_relaxed);
+            newInternal->right.store(pack(leafFirst ? newLeaf : leaf), std::memory_order_relaxed);
+
+            uintptr_t expected = pack(leaf);
+            if (child.compare_exchange_strong(expected, pack(newInternal))) {
+                return true;
+            }
+            // Ребро помечено чужим удалением — помогаем его закончить
+            if (address(expected) == leaf && (expected & kMarks) != 0) {
+                cleanup(key, s);
+            }
+        }
+    }
+
+    bool search(int key) const {
+        EpochDomain::Guard guard(epochs);
+        const Node* node = sentinel;
+        uintptr_t field = node->left.load(std::memory_order_acquire);
+        while (address(field) != nullptr) {
+            node = address(field);
+            field = (key < node->key ? node->left : node->right).load(std::memory_order_acquire);
+        }
+        return node->key == key;
+    }
+
+    bool remove(int key) {
+        EpochDomain::Guard guard(epochs);
+        SeekRecord s;
+        Node* leaf = nullptr;
+        while (true) {
+            seek(key, s);
+            std::atomic<uintptr_t>& child = key < s.parent->key ? s.parent->left : s.parent->right;
+            if (leaf == nullptr) {
+                // Фаза пометки: ключ удалён в момент успешного CAS с флагом
+                if (s.leaf->key != key) {
+                    return false;
+                }
+                uintptr_t expected = pack(s.leaf);
+                if (child.compare_exchange_strong(expected, expected | kFlag)) {
+                    leaf = s.leaf;
+                    if (cleanup(key, s)) {
+                        return true;
+                    }
+                }
+                else if (address(expected) == s.leaf && (expected & kMarks) != 0) {
+                    cleanup(key, s);
+                }
+            }
+            else {
+                // Фаза отсоединения: лист уже убрал кто-то из помогавших
+                if (s.leaf != leaf || cleanup(key, s)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    // Дальше — операции над деревом целиком. Они не защищены от параллельных
+    // изменений и вызываются, когда с деревом работает один поток
+
+    // Значения по возрастанию в отрезке [lo, hi]. Без рекурсии: при вставке
+    // по возрастанию дерево вырождается в список
+    template <class Visit>
+    void scan(int lo, int hi, Visit visit) const {
+        std::vector<const Node*> stack(1, address(sentinel->left.load()));
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            if (childOf(node, false) == nullptr) {
+                if (node->key >= lo && node->key <= hi) visit(static_cast<int>(node->key));
+                continue;
+            }
+            // Правое поддерево кладём первым, чтобы левое обошлось раньше
+            if (hi >= node->key) stack.push_back(childOf(node, true));
+            if (lo < node->key) stack.push_back(childOf(node, false));
+        }
+    }
+
+    // Высота в узлах, считая внутренние; ограничители не учитываются
+    int height() const {
+        int result = 0;
+        std::vector<std::pair<const Node*, int>> stack(1, std::make_pair(address(sentinel->left.load()), 0));
+        while (!stack.empty()) {
+            const Node* node = stack.back().first;
+            int depth = stack.back().second;
+            stack.pop_back();
+            if (node == nullptr) {
+                result = std::max(result, depth);
+                continue;
+            }
+            stack.push_back(std::make_pair(childOf(node, false), depth + 1));
+            stack.push_back(std::make_pair(childOf(node, true), depth + 1));
+        }
+        return result - 1;
+    }
+
+    FrozenTree freeze() const {
+        std::vector<int> values;
+        scan(INT_MIN, INT_MAX, [&values](int v) { values.push_back(v); });
+        return FrozenTree(values);
+    }
+
+    // Сбалансированное дерево из отсортированных ключей (повторы пропускаются)
+    // на место текущего содержимого
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        std::vector<int> unique;
+        unique.reserve(keys.size());
+        std::unique_copy(keys.begin(), keys.end(), std::back_inserter(unique));
+        if (unique.empty()) {
+            return;
+        }
+        // Последний лист — ограничитель: слева от него ключи меньше kInf0
+        Node* built = buildBalanced(unique.data(), unique.size());
+        Node* bottom = new Node(kInf0, built, new Node(kInf0));
+        destroy(address(sentinel->left.load()));
+        sentinel->left.store(pack(bottom));
+    }
+
+    // Как и buildFromSorted, не должен идти одновременно с другими операциями
+    void clear() {
+        destroy(address(sentinel->left.load()));
+        sentinel->left.store(pack(new Node(kInf0)));
+        epochs.drain();
+    }
+
+private:
+    // Ограничители: kInf0 < kInf1 < kInf2, все больше любого int
+    static const long long kInf0 = static_cast<long long>(INT_MAX) + 1;
+    static const long long kInf1 = kInf0 + 1;
+    static const long long kInf2 = kInf0 + 2;
+
+    static const uintptr_t kFlag = 1;  // Лист на этом ребре удаляется
+    static const uintptr_t kTag = 2;   // Ребро заморожено: его поднимут на уровень выше
+    static const uintptr_t kMarks = kFlag | kTag;
+
+    struct alignas(8) Node {
+        long long key;
+        std::atomic<uintptr_t> left;   // Указатель на потомка с битами kFlag, kTag
+        std::atomic<uintptr_t> right;
+
+        explicit Node(long long k) : key(k), left(0), right(0) {}
+        Node(long long k, Node* l, Node* r) : key(k), left(pack(l)), right(pack(r)) {}
+    };
+
+    // Результат спуска: лист, его родитель и последнее ребро без тега выше родителя
+    // (ancestor -> successor) — его и меняет CAS при отсоединении
+    struct SeekRecord {
+        Node* ancestor;
+        Node* successor;
+        Node* parent;
+        Node* leaf;
+    };
+
+    Node* root;
+    Node* sentinel;                    // Узел kInf1: настоящее дерево — его левое поддерево
+    mutable EpochDomain epochs;         // retire без блокировок: у каждого потока свой список
+
+    static uintptr_t pack(Node* node) {
+        return reinterpret_cast<uintptr_t>(node);
+    }
+
+    static Node* address(uintptr_t field) {
+        return reinterpret_cast<Node*>(field & ~kMarks);
+    }
+
+    void seek(int key, SeekRecord& s) const {
+        s.ancestor = root;
+        s.successor = sentinel;
+        s.parent = sentinel;
+        uintptr_t parentField = sentinel->left.load(std::memory_order_acquire);
+        s.leaf = address(parentField);
+        uintptr_t currentField = s.leaf->left.load(std::memory_order_acquire);
+        Node* current = address(currentField);
+        while (current != nullptr) {
+            if ((parentField & kTag) == 0) {
+                s.ancestor = s.parent;
+                s.successor = s.leaf;
+            }
+            s.parent = s.leaf;
+            s.leaf = current;
+            parentField = currentField;
+            currentField = (key < current->key ? current->left : current->right).load(std::memory_order_acquire);
+            current = address(currentField);
+        }
+    }
+
+    // Отсоединяет помеченный лист под s.parent: ребро ancestor -> successor
+    // заменяется братом листа. true, если отсоединил именно этот вызов
+    bool cleanup(int key, const SeekRecord& s) {
+        std::atomic<uintptr_t>& successorEdge = key < s.ancestor->key ? s.ancestor->left : s.ancestor->right;
+        std::atomic<uintptr_t>* childEdge = &(key < s.parent->key ? s.parent->left : s.parent->right);
+        std::atomic<uintptr_t>* siblingEdge = &(key < s.parent->key ? s.parent->right : s.parent->left);
+        if ((childEdge->load(std::memory_order_acquire) & kFlag) == 0) {
+            // Удаляется брат, а наш лист поднимается на его место
+            std::swap(childEdge, siblingEdge);
+        }
+        uintptr_t sibling = siblingEdge->fetch_or(kTag) & ~kTag;
+
+        uintptr_t expected = pack(s.successor);
+        if (!successorEdge.compare_exchange_strong(expected, sibling)) {
+            return false;
+        }
+        retireChain(key, s.successor, s.parent, address(sibling));
+        return true;
+    }
+
+    // Узлы от successor до parent по рёбрам с тегом и их помеченные листья
+    // теперь недоступны; каждый успешный CAS в cleanup откладывает их ровно один раз
+    void retireChain(int key, Node* node, Node* parent, Node* kept) {
+        while (true) {
+            Node* next = address((key < node->key ? node->left : node->right).load(std::memory_order_relaxed));
+            Node* other = address((key < node->key ? node->right : node->left).load(std::memory_order_relaxed));
+            epochs.retire(node, &Tree::reclaimNode, nullptr);
+            if (node == parent) {
+                epochs.retire(next == kept ? other : next, &Tree::reclaimNode, nullptr);
+                return;
+            }
+            epochs.retire(other, &Tree::reclaimNode, nullptr);
+            node = next;
+        }
+    }
+
+    static void reclaimNode(void* node, void*) {
+        delete static_cast<Node*>(node);
+    }
+
+    static Node* buildBalanced(const int* keys, size_t n) {
+        if (n == 1) {
+            return new Node(keys[0]);
+        }
+        // Ключ внутреннего узла — наименьший в правом поддереве
+        size_t half = n / 2;
+        return new Node(keys[half], buildBalanced(keys, half), buildBalanced(keys + half, n - half));
+    }
+
+    static Node* childOf(const Node* node, bool right) {
+        return address((right ? node->right : node->left).load(std::memory_order_relaxed));
+    }
+
+    // Без рекурсии: при вставке по возрастанию дерево вырождается в список
+    static void destroy(Node* node) {
+        std::vector<Node*> stack;
+        if (node) stack.push_back(node);
+        while (!stack.empty()) {
+            Node* current = stack.back();
+            stack.pop_back();
+            if (childOf(current, false)) stack.push_back(childOf(current, false));
+            if (childOf(current, true)) stack.push_back(childOf(current, true));
+            delete current;
+        }
+    }
+
+    Tree(const Tree&) = delete;
+    Tree& operator=(const Tree&) = delete;
+};
+
+} // namespace lfbst
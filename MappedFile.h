@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Файлы снимков и трасс: запись одним последовательным проходом и чтение
+// через mmap без копирования. Ошибки ввода-вывода — std::runtime_error
+// с именем файла.
+
+inline std::runtime_error fileError(const std::string& path, const std::string& what) {
+    return std::runtime_error(path + ": " + what);
+}
+
+// Пишет файл одной последовательной записью во временный файл рядом
+// и переименовывает: читатель никогда не увидит наполовину записанный файл
+inline void writeFileAtomically(const std::string& path, const std::vector<char>& bytes) {
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw fileError(temp, std::strerror(errno));
+    }
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            int e = errno;
+            ::close(fd);
+            std::remove(temp.c_str());
+            throw fileError(temp, std::strerror(e));
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (::close(fd) != 0 || std::rename(temp.c_str(), path.c_str()) != 0) {
+        int e = errno;
+        std::remove(temp.c_str());
+        throw fileError(path, std::strerror(e));
+    }
+}
+
+// Файл, отображённый в память только для чтения. Страницы подгружаются
+// ядром по мере обращения и делятся между процессами, открывшими тот же файл
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : base(nullptr), length(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw fileError(path, std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int e = errno;
+            ::close(fd);
+            throw fileError(path, std::strerror(e));
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            ::close(fd);
+            return; // Пустой файл отобразить нельзя, но и читать в нём нечего
+        }
+        base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        int e = errno;
+        ::close(fd); // Отображение держит файл само
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            throw fileError(path, std::strerror(e));
+        }
+    }
+
+    ~MappedFile() {
+        if (base) ::munmap(base, length);
+    }
+
+    const char* data() const {
+        return static_cast<const char*>(base);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // Подсказка ядру: файл будут читать подряд (упреждающее чтение крупнее)
+    void adviseSequential() const {
+        if (base) ::madvise(base, length, MADV_SEQUENTIAL);
+    }
+
+private:
+    void* base;
+    size_t length;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Пул узлов дерева: узлы нарезаются из больших блоков (slab), освобождённые
+// узлы уходят в список свободных, а release() отдаёт всю память разом —
+// без обхода дерева и без delete для каждого узла.
+//
+// release() деструкторы не вызывает, поэтому разом можно освобождать только
+// тривиально разрушаемые узлы.
+template <class T>
+class NodePool {
+public:
+    explicit NodePool(size_t firstSlabNodes = 256) : nextSlabNodes(firstSlabNodes ? firstSlabNodes : 1),
+        cursor(nullptr), slabEnd(nullptr), freeList(nullptr) {}
+
+    ~NodePool() { release(); }
+
+    // Память под один узел (конструктор вызывает вызывающий код)
+    void* allocate() {
+        if (freeList) {
+            FreeSlot* slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+        if (cursor == slabEnd) {
+            newSlab();
+        }
+        void* p = cursor;
+        cursor += sizeof(Slot);
+        return p;
+    }
+
+    void deallocate(void* p) {
+        FreeSlot* slot = static_cast<FreeSlot*>(p);
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    // Освобождаем все узлы пула за O(число блоков); блоки растут вдвое,
+    // поэтому их O(log n)
+    void release() {
+        for (void* slab : slabs) {
+            ::operator delete(slab);
+        }
+        slabs.clear();
+        cursor = slabEnd = nullptr;
+        freeList = nullptr;
+        reserved = 0;
+    }
+
+    size_t bytesReserved() const { return reserved; }
+
+    // Пул, в котором сейчас выделяют узлы типа T в этом потоке (см. PoolAllocated)
+    static NodePool*& current() {
+        thread_local NodePool* pool = nullptr;
+        return pool;
+    }
+
+    // Делает пул текущим на время жизни объекта
+    class Scope {
+    public:
+        explicit Scope(NodePool* pool) : previous(current()) { current() = pool; }
+        ~Scope() { current() = previous; }
+
+    private:
+        NodePool* previous;
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static const size_t kSlotSize = sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot);
+    static const size_t kSlotAlign = alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+
+    struct alignas(kSlotAlign) Slot {
+        unsigned char bytes[kSlotSize];
+    };
+
+    static const size_t kMaxSlabNodes = 1 << 16;
+
+    void newSlab() {
+        size_t bytes = nextSlabNodes * sizeof(Slot);
+        char* slab = static_cast<char*>(::operator new(bytes));
+        slabs.push_back(slab);
+        reserved += bytes;
+        cursor = slab;
+        slabEnd = slab + bytes;
+        if (nextSlabNodes < kMaxSlabNodes) nextSlabNodes *= 2;
+    }
+
+    std::vector<void*> slabs;
+    size_t nextSlabNodes;
+    size_t reserved = 0;
+    char* cursor;
+    char* slabEnd;
+    FreeSlot* freeList;
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+};
+
+// Базовый класс для узлов BST и AVL: `new Node` / `delete` идут в текущий пул
+// потока (NodePool<T>::Scope), а без пула — в обычную кучу.
+// Узлы пула нельзя удалять вне его Scope; проще всего освободить их release().
+template <class T>
+class PoolAllocated {
+public:
+    static void* operator new(size_t size) {
+        static_assert(std::is_trivially_destructible<T>::value, "узлы пула должны быть тривиально разрушаемыми");
+        NodePool<T>* pool = NodePool<T>::current();
+        return pool ? pool->allocate() : ::operator new(size);
+    }
+
+    static void operator delete(void* p) {
+        NodePool<T>* pool = NodePool<T>::current();
+        if (pool) {
+            pool->deallocate(p);
+        }
+        else {
+            ::operator delete(p);
+        }
+    }
+};
+
+// Слот произвольного типа размером Size с выравниванием Align: по нему
+// NodePool нарезает память для всех типов одного размера
+template <size_t Size, size_t Align>
+struct alignas(Align) PoolSlot {
+    unsigned char bytes[Size];
+};
+
+// Общая память аллокатора и всех его копий и rebind: по пулу на каждую пару
+// (размер, выравнивание). Пулы хранятся без типа (shared_ptr<void> со своим
+// деструктором), так что арена одна для любых T
+class PoolArena {
+public:
+    template <class T>
+    NodePool<PoolSlot<sizeof(T), alignof(T)>>* pool() {
+        typedef NodePool<PoolSlot<sizeof(T), alignof(T)>> Pool;
+        for (const Entry& e : pools) {
+            if (e.size == sizeof(T) && e.align == alignof(T)) {
+                return static_cast<Pool*>(e.pool.get());
+            }
+        }
+        std::shared_ptr<void> created(new Pool(), [](void* p) { delete static_cast<Pool*>(p); });
+        pools.push_back(Entry{ sizeof(T), alignof(T), created });
+        return static_cast<Pool*>(created.get());
+    }
+
+private:
+    struct Entry {
+        size_t size;
+        size_t align;
+        std::shared_ptr<void> pool;
+    };
+
+    std::vector<Entry> pools; // Обычно один-два размера: линейный поиск, и только при создании аллокатора
+};
+
+// Аллокатор в стиле STL поверх NodePool для контейнеров вроде OrderedTree.
+// Копии и rebind делят одну арену и поэтому равны: память, выделенная одним,
+// освобождается любым из них. Выделения больше одного объекта идут в обычную кучу.
+// Как и NodePool, не потокобезопасен
+template <class T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator() : arena(std::make_shared<PoolArena>()), pool(arena->pool<T>()) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) : arena(other.arena), pool(arena->pool<T>()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(n == 1 ? pool->allocate() : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n == 1) {
+            pool->deallocate(p);
+        }
+        else {
+            ::operator delete(p);
+        }
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>& other) const { return arena == other.arena; }
+
+    template <class U>
+    bool operator!=(const PoolAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <class U> friend class PoolAllocator;
+
+    std::shared_ptr<PoolArena> arena;
+    NodePool<PoolSlot<sizeof(T), alignof(T)>>* pool; // Пул арены для T, найден один раз
+};
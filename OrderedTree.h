@@ -0,0 +1,512 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+
+// Обобщённое упорядоченное дерево (словарь ключ -> значение):
+//
+//   OrderedTree<Key, Value, Compare, BalancePolicy, Allocator>
+//
+// Балансировка — параметр шаблона: PlainBalance (обычное BST), AVLBalance и
+// RedBlackBalance повторяют поведение BST.h, AVL.h и RB.h, но компилятор
+// подставляет сравнение и код балансировки для конкретного типа ключа.
+// Ключи уникальны: insert существующего ключа возвращает false.
+//
+// Политика описывает метаданные узла (Meta) и три точки расширения:
+//   update(node)                     — пересчитать метаданные по потомкам;
+//   afterInsert(tree, node)          — восстановить баланс после вставки листа;
+//   afterErase(tree, x, xParent, m)  — после удаления узла с метаданными m,
+//                                      на место которого встал x (может быть nullptr).
+
+template <class Key, class Value, class Meta>
+struct OrderedTreeNode {
+    Key key;
+    Value value;
+    OrderedTreeNode* left;
+    OrderedTreeNode* right;
+    OrderedTreeNode* parent;
+    Meta meta;
+
+    OrderedTreeNode(const Key& k, const Value& v) : key(k), value(v), left(nullptr), right(nullptr), parent(nullptr), meta() {}
+};
+
+// Обычное дерево поиска без балансировки
+struct PlainBalance {
+    struct Meta {};
+
+    template <class Node>
+    static void update(Node*) {}
+
+    template <class Tree, class Node>
+    static void afterInsert(Tree&, Node*) {}
+
+    template <class Tree, class Node>
+    static void afterErase(Tree&, Node*, Node*, const Meta&) {}
+};
+
+// AVL: в узле хранится высота поддерева
+struct AVLBalance {
+    struct Meta {
+        int height = 1;
+    };
+
+    template <class Node>
+    static int height(Node* node) {
+        return node ? node->meta.height : 0;
+    }
+
+    template <class Node>
+    static int balance(Node* node) {
+        return height(node->left) - height(node->right);
+    }
+
+    template <class Node>
+    static void update(Node* node) {
+        node->meta.height = 1 + std::max(height(node->left), height(node->right));
+    }
+
+    // Поднимаемся от node к корню, пересчитываем высоты и делаем повороты
+    template <class Tree, class Node>
+    static void retrace(Tree& tree, Node* node) {
+        while (node) {
+            update(node);
+            int b = balance(node);
+            if (b > 1) {
+                if (balance(node->left) < 0) tree.rotateLeft(node->left);
+                node = tree.rotateRight(node);
+            }
+            else if (b < -1) {
+                if (balance(node->right) > 0) tree.rotateRight(node->right);
+                node = tree.rotateLeft(node);
+            }
+            node = node->parent;
+        }
+    }
+
+    template <class Tree, class Node>
+    static void afterInsert(Tree& tree, Node* node) {
+        retrace(tree, node->parent);
+    }
+
+    template <class Tree, class Node>
+    static void afterErase(Tree& tree, Node*, Node* xParent, const Meta&) {
+        retrace(tree, xParent);
+    }
+};
+
+// Красно-чёрное дерево: в узле хранится цвет, отсутствующий потомок считается чёрным
+struct RedBlackBalance {
+    struct Meta {
+        bool red = true;
+    };
+
+    template <class Node>
+    static bool isRed(Node* node) {
+        return node && node->meta.red;
+    }
+
+    template <class Node>
+    static void update(Node*) {}
+
+    template <class Tree, class Node>
+    static void afterInsert(Tree& tree, Node* pt) {
+        while (pt->meta.red && pt->parent && pt->parent->meta.red) {
+            Node* parent = pt->parent;
+            Node* grandParent = parent->parent;
+            if (parent == grandParent->left) {
+                Node* uncle = grandParent->right;
+                if (isRed(uncle)) {
+                    grandParent->meta.red = true;
+                    parent->meta.red = false;
+                    uncle->meta.red = false;
+                    pt = grandParent;
+                }
+                else {
+                    if (pt == parent->right) {
+                        tree.rotateLeft(parent);
+                        pt = parent;
+                        parent = pt->parent;
+                    }
+                    tree.rotateRight(grandParent);
+                    std::swap(parent->meta.red, grandParent->meta.red);
+                    pt = parent;
+                }
+            }
+            else {
+                Node* uncle = grandParent->left;
+                if (isRed(uncle)) {
+                    grandParent->meta.red = true;
+                    parent->meta.red = false;
+                    uncle->meta.red = false;
+                    pt = grandParent;
+                }
+                else {
+                    if (pt == parent->left) {
+                        tree.rotateRight(parent);
+                        pt = parent;
+                        parent = pt->parent;
+                    }
+                    tree.rotateLeft(grandParent);
+                    std::swap(parent->meta.red, grandParent->meta.red);
+                    pt = parent;
+                }
+            }
+        }
+        tree.root()->meta.red = false;
+    }
+
+    template <class Tree, class Node>
+    static void afterErase(Tree& tree, Node* x, Node* xParent, const Meta& removed) {
+        if (removed.red) return;
+        while (x != tree.root() && !isRed(x)) {
+            if (x == xParent->left) {
+                Node* s = xParent->right;
+                if (isRed(s)) {
+                    s->meta.red = false;
+                    xParent->meta.red = true;
+                    tree.rotateLeft(xParent);
+                    s = xParent->right;
+                }
+                if (!isRed(s->left) && !isRed(s->right)) {
+                    s->meta.red = true;
+                    x = xParent;
+                    xParent = x->parent;
+                }
+                else {
+                    if (!isRed(s->right)) {
+                        s->left->meta.red = false;
+                        s->meta.red = true;
+                        tree.rotateRight(s);
+                        s = xParent->right;
+                    }
+                    s->meta.red = xParent->meta.red;
+                    xParent->meta.red = false;
+                    s->right->meta.red = false;
+                    tree.rotateLeft(xParent);
+                    x = tree.root();
+                    xParent = nullptr;
+                }
+            }
+            else {
+                Node* s = xParent->left;
+                if (isRed(s)) {
+                    s->meta.red = false;
+                    xParent->meta.red = true;
+                    tree.rotateRight(xParent);
+                    s = xParent->left;
+                }
+                if (!isRed(s->left) && !isRed(s->right)) {
+                    s->meta.red = true;
+                    x = xParent;
+                    xParent = x->parent;
+                }
+                else {
+                    if (!isRed(s->left)) {
+                        s->right->meta.red = false;
+                        s->meta.red = true;
+                        tree.rotateLeft(s);
+                        s = xParent->left;
+                    }
+                    s->meta.red = xParent->meta.red;
+                    xParent->meta.red = false;
+                    s->left->meta.red = false;
+                    tree.rotateRight(xParent);
+                    x = tree.root();
+                    xParent = nullptr;
+                }
+            }
+        }
+        if (x) x->meta.red = false;
+    }
+};
+
+template <class Key, class Value, class Compare = std::less<Key>, class BalancePolicy = AVLBalance,
+          class Allocator = std::allocator<std::pair<const Key, Value>>>
+class OrderedTree {
+public:
+    typedef OrderedTreeNode<Key, Value, typename BalancePolicy::Meta> Node;
+
+    explicit OrderedTree(const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+        : rootNode(nullptr), count(0), less(comp), nodeAlloc(alloc) {}
+
+    ~OrderedTree() { clear(); }
+
+    // Вставка; false, если ключ уже есть (значение не меняется)
+    bool insert(const Key& key, const Value& value) {
+        Node* parent = nullptr;
+        Node* current = rootNode;
+        bool goLeft = false;
+        while (current) {
+            parent = current;
+            if (less(key, current->key)) {
+                goLeft = true;
+                current = current->left;
+            }
+            else if (less(current->key, key)) {
+                goLeft = false;
+                current = current->right;
+            }
+            else {
+                return false;
+            }
+        }
+
+        Node* node = createNode(key, value);
+        node->parent = parent;
+        if (!parent) {
+            rootNode = node;
+        }
+        else if (goLeft) {
+            parent->left = node;
+        }
+        else {
+            parent->right = node;
+        }
+        ++count;
+        BalancePolicy::afterInsert(*this, node);
+        return true;
+    }
+
+    Value* find(const Key& key) {
+        Node* node = findNode(key);
+        return node ? &node->value : nullptr;
+    }
+
+    const Value* find(const Key& key) const {
+        Node* node = findNode(key);
+        return node ? &node->value : nullptr;
+    }
+
+    bool contains(const Key& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    bool erase(const Key& key) {
+        Node* z = findNode(key);
+        if (!z) return false;
+
+        Node* x;
+        Node* xParent;
+        typename BalancePolicy::Meta removed = z->meta;
+        if (!z->left) {
+            x = z->right;
+            xParent = z->parent;
+            transplant(z, z->right);
+        }
+        else if (!z->right) {
+            x = z->left;
+            xParent = z->parent;
+            transplant(z, z->left);
+        }
+        else {
+            // Узел с двумя потомками заменяем преемником y
+            Node* y = z->right;
+            while (y->left) y = y->left;
+            removed = y->meta;
+            x = y->right;
+            if (y->parent == z) {
+                xParent = y;
+            }
+            else {
+                xParent = y->parent;
+                transplant(y, y->right);
+                y->right = z->right;
+                y->right->parent = y;
+            }
+            transplant(z, y);
+            y->left = z->left;
+            y->left->parent = y;
+            y->meta = z->meta;
+        }
+        destroyNode(z);
+        --count;
+        BalancePolicy::afterErase(*this, x, xParent, removed);
+        return true;
+    }
+
+    void clear() {
+        // Обход без стека: спускаемся и удаляем узлы по родительским указателям
+        Node* node = rootNode;
+        while (node) {
+            if (node->left) {
+                node = node->left;
+            }
+            else if (node->right) {
+                node = node->right;
+            }
+            else {
+                Node* parent = node->parent;
+                if (parent) {
+                    if (parent->left == node) parent->left = nullptr;
+                    else parent->right = nullptr;
+                }
+                destroyNode(node);
+                node = parent;
+            }
+        }
+        rootNode = nullptr;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Высота дерева обходом в ширину, O(n)
+    int height() const {
+        int levels = 0;
+        std::queue<Node*> q;
+        if (rootNode) q.push(rootNode);
+        while (!q.empty()) {
+            ++levels;
+            for (size_t i = q.size(); i > 0; --i) {
+                Node* node = q.front();
+                q.pop();
+                if (node->left) q.push(node->left);
+                if (node->right) q.push(node->right);
+            }
+        }
+        return levels;
+    }
+
+    // Симметричный обход: f(key, value)
+    template <class F>
+    void forEach(F f) const {
+        Node* node = rootNode;
+        if (!node) return;
+        while (node->left) node = node->left;
+        while (node) {
+            f(static_cast<const Key&>(node->key), node->value);
+            node = successor(node);
+        }
+    }
+
+    // Симметричный обход ключей из отрезка [lo, hi]: один спуск до lo,
+    // дальше по successor — O(log n + k)
+    template <class F>
+    void forEachInRange(const Key& lo, const Key& hi, F f) const {
+        Node* node = nullptr;
+        Node* current = rootNode;
+        while (current) {
+            if (less(current->key, lo)) {
+                current = current->right;
+            }
+            else {
+                node = current;
+                current = current->left;
+            }
+        }
+        for (; node && !less(hi, node->key); node = successor(node)) {
+            f(static_cast<const Key&>(node->key), node->value);
+        }
+    }
+
+    Node* root() const { return rootNode; }
+
+    // Повороты доступны политикам балансировки; возвращают новый корень поддерева
+    Node* rotateLeft(Node* pt) {
+        Node* y = pt->right;
+        pt->right = y->left;
+        if (y->left) y->left->parent = pt;
+        replaceChild(pt, y);
+        y->left = pt;
+        pt->parent = y;
+        BalancePolicy::update(pt);
+        BalancePolicy::update(y);
+        return y;
+    }
+
+    Node* rotateRight(Node* pt) {
+        Node* y = pt->left;
+        pt->left = y->right;
+        if (y->right) y->right->parent = pt;
+        replaceChild(pt, y);
+        y->right = pt;
+        pt->parent = y;
+        BalancePolicy::update(pt);
+        BalancePolicy::update(y);
+        return y;
+    }
+
+private:
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+    typedef std::allocator_traits<NodeAllocator> NodeTraits;
+
+    Node* rootNode;
+    size_t count;
+    Compare less;
+    NodeAllocator nodeAlloc;
+
+    Node* createNode(const Key& key, const Value& value) {
+        Node* node = NodeTraits::allocate(nodeAlloc, 1);
+        NodeTraits::construct(nodeAlloc, node, key, value);
+        return node;
+    }
+
+    void destroyNode(Node* node) {
+        NodeTraits::destroy(nodeAlloc, node);
+        NodeTraits::deallocate(nodeAlloc, node, 1);
+    }
+
+    Node* findNode(const Key& key) const {
+        Node* current = rootNode;
+        while (current) {
+            if (less(key, current->key)) {
+                current = current->left;
+            }
+            else if (less(current->key, key)) {
+                current = current->right;
+            }
+            else {
+                return current;
+            }
+        }
+        return nullptr;
+    }
+
+    static Node* successor(Node* node) {
+        if (node->right) {
+            node = node->right;
+            while (node->left) node = node->left;
+            return node;
+        }
+        Node* parent = node->parent;
+        while (parent && node == parent->right) {
+            node = parent;
+            parent = parent->parent;
+        }
+        return parent;
+    }
+
+    // Ставим y на место pt в родителе pt
+    void replaceChild(Node* pt, Node* y) {
+        y->parent = pt->parent;
+        if (!pt->parent) {
+            rootNode = y;
+        }
+        else if (pt == pt->parent->left) {
+            pt->parent->left = y;
+        }
+        else {
+            pt->parent->right = y;
+        }
+    }
+
+    void transplant(Node* u, Node* v) {
+        if (!u->parent) {
+            rootNode = v;
+        }
+        else if (u == u->parent->left) {
+            u->parent->left = v;
+        }
+        else {
+            u->parent->right = v;
+        }
+        if (v) v->parent = u->parent;
+    }
+
+    OrderedTree(const OrderedTree&) = delete;
+    OrderedTree& operator=(const OrderedTree&) = delete;
+};
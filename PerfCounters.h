@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+// Аппаратные счётчики процессора через perf_event_open: не только «RB
+// медленнее AVL», но и почему — промахи кэша, TLB или предсказателя переходов.
+//
+// Каждый счётчик открывается отдельно, а не группой: событие, которого нет
+// на этой машине (в виртуалке без PMU, при perf_event_paranoid > 2, на чужой
+// архитектуре), выключает только себя. Если событий больше, чем регистров
+// PMU, ядро делит их по времени; значения тогда масштабируются на долю
+// времени, когда событие действительно считалось. Считается только
+// пользовательский код (exclude_kernel — так работает и при paranoid = 2)
+// и потоки, созданные после start() (inherit).
+
+enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES };
+
+const int kCounterCount = 6;
+
+const char* const kCounterNames[] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+};
+
+// Значения за интервал start() — stop(); -1 — счётчик недоступен
+struct Reading {
+    double values[kCounterCount];
+
+    Reading() {
+        for (double& v : values) v = -1;
+    }
+
+    bool has(Counter c) const { return values[c] >= 0; }
+    double operator[](Counter c) const { return values[c]; }
+};
+
+class Counters {
+public:
+    Counters() {
+        for (int c = 0; c < kCounterCount; ++c) {
+            fds[c] = -1;
+            errors[c] = ENOSYS;
+        }
+#ifdef __linux__
+        const uint64_t kRead = PERF_COUNT_HW_CACHE_OP_READ << 8;
+        const uint64_t kMiss = PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        open(CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(L1D_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | kRead | kMiss);
+        // Обобщённое событие «промах кэша» на x86 и есть промах LLC
+        if (!open(LLC_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | kRead | kMiss)) {
+            open(LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        }
+        open(DTLB_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | kRead | kMiss);
+        open(BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    }
+
+    ~Counters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    bool available(Counter c) const { return fds[c] >= 0; }
+
+    // Открылся хотя бы один счётчик
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    // Почему не открылся первый недоступный счётчик (пусто, если открылись все)
+    std::string error() const {
+        for (int c = 0; c < kCounterCount; ++c) {
+            if (fds[c] < 0) return std::string(kCounterNames[c]) + ": " + describe(errors[c]);
+        }
+        return std::string();
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    Reading stop() {
+        Reading r;
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int c = 0; c < kCounterCount; ++c) {
+            // value, time_enabled, time_running (PERF_FORMAT_TOTAL_TIME_*)
+            uint64_t data[3];
+            if (fds[c] < 0 || ::read(fds[c], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+                continue;
+            }
+            if (data[2] == 0) {
+                r.values[c] = data[1] == 0 ? 0 : -1; // Включён, но ни разу не попал на PMU
+                continue;
+            }
+            r.values[c] = static_cast<double>(data[0]) * data[1] / data[2];
+        }
+#endif
+        return r;
+    }
+
+private:
+    int fds[kCounterCount];
+    int errors[kCounterCount];  // errno неудачного открытия
+
+#ifdef __linux__
+    bool open(Counter c, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            errors[c] = errno;
+            return false;
+        }
+        fds[c] = fd;
+        return true;
+    }
+#endif
+
+    static std::string describe(int e) {
+#ifndef __linux__
+        (void)e;
+        return "perf_event_open есть только в Linux";
+#else
+        switch (e) {
+        case ENOENT:
+        case EOPNOTSUPP:
+            return "событие не поддерживается (нет PMU, например в виртуальной машине)";
+        case EACCES:
+        case EPERM:
+            return "нет прав (см. /proc/sys/kernel/perf_event_paranoid)";
+        case ENOSYS:
+            return "ядро собрано без perf_event_open";
+        default:
+            return std::strerror(e);
+        }
+#endif
+    }
+
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+};
+
+} // namespace perf
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "Epoch.h"
+#include "FrozenTree.h"
+#include "TreeIterator.h"
+
+namespace pavl {
+
+// Персистентное AVL-дерево: узлы после создания не меняются, вставка
+// и удаление копируют только путь от корня до места изменения (O(log n) узлов),
+// остальное поддерево разделяется со старой версией. Каждая версия — это
+// корень, поэтому снимок — копия указателя, O(1).
+//
+// Узел живёт, пока на него ссылается хоть одна версия или родитель: счётчик
+// ссылок атомарный, так что версии можно держать и отпускать из разных потоков.
+// Ключи уникальны: вставка существующего ключа версию не меняет.
+class Node {
+public:
+    const int value;
+    const Node* const left;
+    const Node* const right;
+    const int height;
+    const int size;     // Число узлов в поддереве
+
+    // Новый узел со ссылкой 1 забирает ссылки на потомков
+    static const Node* make(int value, const Node* left, const Node* right) {
+        return new Node(value, left, right);
+    }
+
+    static const Node* retain(const Node* node) {
+        if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    // Отпускает ссылку; узлы, на которые больше никто не ссылается, удаляются
+    // вместе с их ссылками на потомков (без рекурсии: цепочка может быть длинной)
+    static void release(const Node* node) {
+        std::vector<const Node*> stack;
+        while (true) {
+            if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                stack.push_back(node->left);
+                stack.push_back(node->right);
+                delete node;
+            }
+            if (stack.empty()) {
+                return;
+            }
+            node = stack.back();
+            stack.pop_back();
+        }
+    }
+
+    static int heightOf(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    static int sizeOf(const Node* node) {
+        return node ? node->size : 0;
+    }
+
+    // Дальше функции получают и возвращают собственные ссылки (retain уже сделан);
+    // nullptr из insert означает «ключ уже есть, дерево не изменилось»
+
+    // Узел value с потомками left и right, с поворотами при перекосе на 2
+    static const Node* balance(int value, const Node* left, const Node* right) {
+        if (heightOf(left) > heightOf(right) + 1) {
+            const Node* l = left;
+            const Node* result;
+            if (heightOf(l->left) >= heightOf(l->right)) {
+                // Правый поворот
+                result = make(l->value, retain(l->left), make(value, retain(l->right), right));
+            }
+            else {
+                // Левый правый случай
+                const Node* lr = l->right;
+                result = make(lr->value, make(l->value, retain(l->left), retain(lr->left)),
+                                         make(value, retain(lr->right), right));
+            }
+            release(l);
+            return result;
+        }
+        if (heightOf(right) > heightOf(left) + 1) {
+            const Node* r = right;
+            const Node* result;
+            if (heightOf(r->right) >= heightOf(r->left)) {
+                // Левый поворот
+                result = make(r->value, make(value, left, retain(r->left)), retain(r->right));
+            }
+            else {
+                // Правый левый случай
+                const Node* rl = r->left;
+                result = make(rl->value, make(value, left, retain(rl->left)),
+                                         make(r->value, retain(rl->right), retain(r->right)));
+            }
+            release(r);
+            return result;
+        }
+        return make(value, left, right);
+    }
+
+    static const Node* insert(const Node* node, int key) {
+        if (!node) {
+            return make(key, nullptr, nullptr);
+        }
+        if (key == node->value) {
+            return nullptr;
+        }
+        if (key < node->value) {
+            const Node* l = insert(node->left, key);
+            return l ? balance(node->value, l, retain(node->right)) : nullptr;
+        }
+        const Node* r = insert(node->right, key);
+        return r ? balance(node->value, retain(node->left), r) : nullptr;
+    }
+
+    // Новая версия без key; nullptr, если ключа нет. Пустое дерево после
+    // удаления последнего узла — это тоже nullptr, поэтому результат
+    // сообщается через removed
+    static const Node* remove(const Node* node, int key, bool& removed) {
+        if (!node) {
+            removed = false;
+            return nullptr;
+        }
+        if (key < node->value) {
+            const Node* l = remove(node->left, key, removed);
+            return removed ? balance(node->value, l, retain(node->right)) : nullptr;
+        }
+        if (key > node->value) {
+            const Node* r = remove(node->right, key, removed);
+            return removed ? balance(node->value, retain(node->left), r) : nullptr;
+        }
+        removed = true;
+        if (!node->left || !node->right) {
+            return retain(node->left ? node->left : node->right);
+        }
+        // Место узла занимает наименьший ключ правого поддерева
+        const Node* m = node->right;
+        while (m->left) m = m->left;
+        return balance(m->value, retain(node->left), removeMin(node->right));
+    }
+
+    static const Node* removeMin(const Node* node) {
+        if (!node->left) {
+            return retain(node->right);
+        }
+        return balance(node->value, removeMin(node->left), retain(node->right));
+    }
+
+    // Сбалансированное дерево из отсортированных ключей за O(n)
+    static const Node* buildBalanced(const int* keys, size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        size_t mid = n / 2;
+        return make(keys[mid], buildBalanced(keys, mid), buildBalanced(keys + mid + 1, n - mid - 1));
+    }
+
+private:
+    mutable std::atomic<int> refs;
+
+    Node(int val, const Node* l, const Node* r)
+        : value(val), left(l), right(r), height(1 + std::max(heightOf(l), heightOf(r))),
+          size(1 + sizeOf(l) + sizeOf(r)), refs(1) {}
+
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+};
+
+// Версия дерева: владеет ссылкой на корень. Копирование — снимок за O(1),
+// изменения возвращают новую версию, а эта остаётся прежней
+class Version {
+public:
+    typedef PathIterator<const Node> Iterator;
+
+    Version() : root(nullptr) {}
+    Version(const Version& other) : root(Node::retain(other.root)) {}
+    Version(Version&& other) : root(other.root) { other.root = nullptr; }
+    ~Version() { Node::release(root); }
+
+    Version& operator=(Version other) {
+        std::swap(root, other.root);
+        return *this;
+    }
+
+    // Забирает уже сделанную ссылку на корень
+    static Version adopt(const Node* root) {
+        Version v;
+        v.root = root;
+        return v;
+    }
+
+    // Отдаёт ссылку на корень вызывающему коду
+    const Node* detach() {
+        const Node* r = root;
+        root = nullptr;
+        return r;
+    }
+
+    Version insert(int key) const {
+        const Node* r = Node::insert(root, key);
+        return r ? adopt(r) : *this;
+    }
+
+    Version remove(int key) const {
+        bool removed = false;
+        const Node* r = Node::remove(root, key, removed);
+        return removed ? adopt(r) : *this;
+    }
+
+    // Версия из отсортированных ключей (повторы пропускаются)
+    static Version buildFromSorted(const std::vector<int>& keys) {
+        std::vector<int> unique;
+        unique.reserve(keys.size());
+        std::unique_copy(keys.begin(), keys.end(), std::back_inserter(unique));
+        return adopt(Node::buildBalanced(unique.data(), unique.size()));
+    }
+
+    bool contains(int key) const {
+        const Node* current = root;
+        while (current && current->value != key) {
+            current = key < current->value ? current->left : current->right;
+        }
+        return current != nullptr;
+    }
+
+    size_t size() const { return Node::sizeOf(root); }
+    int height() const { return Node::heightOf(root); }
+    bool empty() const { return root == nullptr; }
+    const Node* rootNode() const { return root; }
+
+    Iterator begin() const { return Iterator::first(root); }
+    Iterator end() const { return Iterator(root); }
+    Iterator lowerBound(int key) const { return Iterator::lowerBound(root, key); }
+    Iterator upperBound(int key) const { return Iterator::upperBound(root, key); }
+
+    // Значения из отрезка [lo, hi] по возрастанию; при lo > hi — пусто
+    IteratorRange<Iterator> range(int lo, int hi) const {
+        if (lo > hi) {
+            return IteratorRange<Iterator>(end(), end());
+        }
+        return IteratorRange<Iterator>(lowerBound(lo), upperBound(hi));
+    }
+
+    template <class F>
+    void scan(int lo, int hi, F visit) const {
+        for (int v : range(lo, hi)) visit(v);
+    }
+
+    FrozenTree freeze() const {
+        std::vector<int> sorted;
+        sorted.reserve(size());
+        scan(INT_MIN, INT_MAX, [&sorted](int v) { sorted.push_back(v); });
+        return FrozenTree(sorted);
+    }
+
+private:
+    const Node* root;
+};
+
+// Изменяемое дерево с общими снимками: один писатель публикует новые версии,
+// а snapshot() из любого потока без блокировок берёт текущую. Снимок не
+// меняется, пока его держат, и не мешает писателю. Между чтением указателя
+// на корень и увеличением счётчика ссылок корень мог бы освободиться,
+// поэтому старые корни писатель отпускает через домен эпох (Epoch.h)
+class SnapshotTree {
+public:
+    SnapshotTree() : head(nullptr) {}
+
+    ~SnapshotTree() {
+        Node::release(head.load());
+    }
+
+    // Любой поток
+    Version snapshot() const {
+        EpochDomain::Guard guard(epochs);
+        return Version::adopt(Node::retain(head.load(std::memory_order_acquire)));
+    }
+
+    // Дальше — только писатель. Ему эпоха не нужна: корень отпускает он сам
+
+    Version current() const {
+        return Version::adopt(Node::retain(head.load(std::memory_order_relaxed)));
+    }
+
+    void insert(int key) {
+        publish(current().insert(key));
+    }
+
+    void remove(int key) {
+        publish(current().remove(key));
+    }
+
+    void publish(Version next) {
+        if (next.rootNode() == head.load(std::memory_order_relaxed)) {
+            return; // Ничего не изменилось
+        }
+        const Node* previous = head.exchange(next.detach(), std::memory_order_acq_rel);
+        if (previous) {
+            epochs.retire(const_cast<Node*>(previous), &SnapshotTree::releaseRoot, nullptr);
+        }
+    }
+
+private:
+    std::atomic<const Node*> head;
+    mutable EpochDomain epochs;
+
+    static void releaseRoot(void* root, void*) {
+        Node::release(static_cast<const Node*>(root));
+    }
+
+    SnapshotTree(const SnapshotTree&) = delete;
+    SnapshotTree& operator=(const SnapshotTree&) = delete;
+};
+
+} // namespace pavl
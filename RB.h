@@ -0,0 +1,1285 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Augment.h"
+#include "BatchSearch.h"
+#include "Epoch.h"
+#include "ForkJoin.h"
+#include "FrozenTree.h"
+#include "NodePool.h"
+#include "TreeIterator.h"
+#include "TreeStats.h"
+#include "TreeVisit.h"
+
+namespace rb {
+
+enum Color { RED, BLACK };
+
+class Node {
+public:
+    int value;
+    bool color;
+    int height;     // Высота поддерева (у TNULL — 0)
+    int copies;     // Кратность значения; больше 1 только после insertCounted
+    SubtreeStats stats; // Размер, сумма, минимум и максимум поддерева (у TNULL — пустая)
+    Node* left, * right, * parent;
+
+    // Конструктор
+    Node(int val) : value(val), color(RED), height(1), copies(1), stats(val), left(nullptr), right(nullptr), parent(nullptr) {}
+
+    // Метод для вывода узла
+    void print(BufferedWriter& out) const {
+        out << "Node(" << value;
+        if (copies > 1) out << " x" << copies;
+        out << ", color=" << (color == RED ? "RED" : "BLACK") << ")\n";
+    }
+
+    void print() const {
+        BufferedWriter out(std::cout);
+        print(out);
+    }
+};
+
+class RedBlackTree {
+public:
+    typedef NodePool<Node> Pool;
+
+private:
+    Node* root;
+    Node* TNULL;
+    Pool* pool;     // Если задан, узлы берутся из пула и освобождаются его release()
+    size_t total;   // Количество значений (с кратностями)
+
+    // Режим конкурентного чтения (enableConcurrentReads): удалённые узлы
+    // откладываются в домен эпох, а version нечётна, пока писатель переставляет
+    // узлы (повороты, перенос преемника при удалении, перестройка)
+    std::unique_ptr<EpochDomain> epochs;
+    std::atomic<uint64_t> version;
+
+    // Окно перестановки узлов: поиск, заставший его и ничего не нашедший,
+    // повторяется. Вставка листа и перекраска окна не требуют: читатель, не
+    // увидевший новый лист, просто упорядочен до вставки. Ссылки root, left
+    // и right, по которым ходят читатели, пишутся только атомарно и с release.
+    // Внутри окна хватило бы relaxed после барьера в его начале, но TSan
+    // барьеров не видит, а на x86 release-запись — та же обычная запись
+    class Restructure {
+    public:
+        explicit Restructure(RedBlackTree& t) : tree(t) {
+            if (tree.epochs) {
+                tree.version.store(tree.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+        }
+
+        ~Restructure() {
+            if (tree.epochs) {
+                tree.version.store(tree.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        }
+
+    private:
+        RedBlackTree& tree;
+    };
+
+    // Высота красно-чёрного дерева не больше 2 log2(n + 1): за столько шагов
+    // спуск заканчивается, если дерево не менялось
+    static const int kMaxReadSteps = 128;
+
+    Node* createNode(int key) {
+        return pool ? new (pool->allocate()) Node(key) : new Node(key);
+    }
+
+    // С конкурентными читателями узел удаляется, только когда его уже никто не видит
+    void destroyNode(Node* node) {
+        if (epochs) {
+            epochs->retire(node, &RedBlackTree::reclaimNode, pool);
+        }
+        else {
+            reclaimNode(node, pool);
+        }
+    }
+
+    static void reclaimNode(void* node, void* nodePool) {
+        if (nodePool) {
+            static_cast<Pool*>(nodePool)->deallocate(node);
+        }
+        else {
+            delete static_cast<Node*>(node);
+        }
+    }
+
+    // Вспомогательные функции для вращений
+    void initializeNULLNode(Node* node, Node* parent) {
+        node->value = 0;
+        node->color = BLACK;
+        node->height = 0;
+        node->copies = 1;
+        node->stats = SubtreeStats();
+        node->left = nullptr;
+        node->right = nullptr;
+        node->parent = parent;
+    }
+
+    // Пересчёт высоты и сводки узла по его потомкам
+    void updateNode(Node* node) {
+        node->height = 1 + std::max(node->left->height, node->right->height);
+        node->stats = SubtreeStats::combine(node->left->stats, node->value, node->copies, node->right->stats);
+    }
+
+    // Пересчитываем высоты и сводки от узла до корня: O(log n)
+    void updateNodesUp(Node* node) {
+        while (node != nullptr && node != TNULL) {
+            updateNode(node);
+            node = node->parent;
+        }
+    }
+
+    void leftRotate(Node*& pt, Node*& ppt) {
+        treestats::count(treestats::ROTATIONS);
+        Node* y = pt->right;
+        {
+            Restructure section(*this);
+            __atomic_store_n(&pt->right, y->left, __ATOMIC_RELEASE);
+            if (y->left != TNULL) {
+                y->left->parent = pt;
+            }
+            y->parent = ppt;
+            if (pt == root) {
+                __atomic_store_n(&root, y, __ATOMIC_RELEASE);
+            }
+            else if (pt == ppt->left) {
+                __atomic_store_n(&ppt->left, y, __ATOMIC_RELEASE);
+            }
+            else {
+                __atomic_store_n(&ppt->right, y, __ATOMIC_RELEASE);
+            }
+            __atomic_store_n(&y->left, pt, __ATOMIC_RELEASE);
+            pt->parent = y;
+        }
+        updateNode(pt);
+        updateNodesUp(y);
+    }
+
+    void rightRotate(Node*& pt, Node*& ppt) {
+        treestats::count(treestats::ROTATIONS);
+        Node* y = pt->left;
+        {
+            Restructure section(*this);
+            __atomic_store_n(&pt->left, y->right, __ATOMIC_RELEASE);
+            if (y->right != TNULL) {
+                y->right->parent = pt;
+            }
+            y->parent = ppt;
+            if (pt == root) {
+                __atomic_store_n(&root, y, __ATOMIC_RELEASE);
+            }
+            else if (pt == ppt->left) {
+                __atomic_store_n(&ppt->left, y, __ATOMIC_RELEASE);
+            }
+            else {
+                __atomic_store_n(&ppt->right, y, __ATOMIC_RELEASE);
+            }
+            __atomic_store_n(&y->right, pt, __ATOMIC_RELEASE);
+            pt->parent = y;
+        }
+        updateNode(pt);
+        updateNodesUp(y);
+    }
+
+    void fixInsert(Node*& pt) {
+        Node* parent_pt = nullptr;
+        Node* grand_parent_pt = nullptr;
+
+        while ((pt != root) && (pt->color != BLACK) && (pt->parent->color == RED)) {
+            treestats::count(treestats::FIX_INSERT_ITERATIONS);
+            parent_pt = pt->parent;
+            grand_parent_pt = pt->parent->parent;
+
+            if (parent_pt == grand_parent_pt->left) {
+                Node* uncle_pt = grand_parent_pt->right;
+                if (uncle_pt != TNULL && uncle_pt->color == RED) {
+                    grand_parent_pt->color = RED;
+                    parent_pt->color = BLACK;
+                    uncle_pt->color = BLACK;
+                    treestats::count(treestats::RECOLORS, 3);
+                    pt = grand_parent_pt;
+                }
+                else {
+                    if (pt == parent_pt->right) {
+                        leftRotate(parent_pt, grand_parent_pt);
+                        pt = parent_pt;
+                        parent_pt = pt->parent;
+                    }
+                    rightRotate(grand_parent_pt, grand_parent_pt->parent);
+                    std::swap(parent_pt->color, grand_parent_pt->color);
+                    treestats::count(treestats::RECOLORS, 2);
+                    pt = parent_pt;
+                }
+            }
+            else {
+                Node* uncle_pt = grand_parent_pt->left;
+                if ((uncle_pt != TNULL) && (uncle_pt->color == RED)) {
+                    grand_parent_pt->color = RED;
+                    parent_pt->color = BLACK;
+                    uncle_pt->color = BLACK;
+                    treestats::count(treestats::RECOLORS, 3);
+                    pt = grand_parent_pt;
+                }
+                else {
+                    if (pt == parent_pt->left) {
+                        rightRotate(parent_pt, grand_parent_pt);
+                        pt = parent_pt;
+                        parent_pt = pt->parent;
+                    }
+                    leftRotate(grand_parent_pt, grand_parent_pt->parent);
+                    std::swap(parent_pt->color, grand_parent_pt->color);
+                    treestats::count(treestats::RECOLORS, 2);
+                    pt = parent_pt;
+                }
+            }
+        }
+        root->color = BLACK;
+        treestats::count(treestats::RECOLORS, 1);
+    }
+
+    void fixDelete(Node* x) {
+        Node* s;
+        while (x != root && x->color == BLACK) {
+            treestats::count(treestats::FIX_DELETE_ITERATIONS);
+            if (x == x->parent->left) {
+                s = x->parent->right;
+                if (s->color == RED) {
+                    s->color = BLACK;
+                    x->parent->color = RED;
+                    treestats::count(treestats::RECOLORS, 2);
+                    leftRotate(x->parent, x->parent->parent);
+                    s = x->parent->right;
+                }
+                if (s->right->color == BLACK && s->left->color == BLACK) {
+                    s->color = RED;
+                    x = x->parent;
+                    treestats::count(treestats::RECOLORS, 1);
+                }
+                else {
+                    if (s->right->color == BLACK) {
+                        s->left->color = BLACK;
+                        s->color = RED;
+                        treestats::count(treestats::RECOLORS, 2);
+                        rightRotate(s, s->parent);
+                        s = x->parent->right;
+                    }
+                    s->color = x->parent->color;
+                    x->parent->color = BLACK;
+                    s->right->color = BLACK;
+                    treestats::count(treestats::RECOLORS, 3);
+                    leftRotate(x->parent, x->parent->parent);
+                    x = root;
+                }
+            }
+            else {
+                s = x->parent->left;
+                if (s->color == RED) {
+                    s->color = BLACK;
+                    x->parent->color = RED;
+                    treestats::count(treestats::RECOLORS, 2);
+                    rightRotate(x->parent, x->parent->parent);
+                    s = x->parent->left;
+                }
+                if (s->left->color == BLACK && s->right->color == BLACK) {
+                    s->color = RED;
+                    x = x->parent;
+                    treestats::count(treestats::RECOLORS, 1);
+                }
+                else {
+                    if (s->left->color == BLACK) {
+                        s->right->color = BLACK;
+                        s->color = RED;
+                        treestats::count(treestats::RECOLORS, 2);
+                        leftRotate(s, s->parent);
+                        s = x->parent->left;
+                    }
+                    s->color = x->parent->color;
+                    x->parent->color = BLACK;
+                    s->left->color = BLACK;
+                    treestats::count(treestats::RECOLORS, 3);
+                    rightRotate(x->parent, x->parent->parent);
+                    x = root;
+                }
+            }
+        }
+        x->color = BLACK;
+        treestats::count(treestats::RECOLORS, 1);
+    }
+
+    // Ставит поддерево v на место u. Ссылку читают конкурентные читатели:
+    // запись с release, так что вне Restructure (удаление узла с одним
+    // потомком) читатель увидит либо u, либо v целиком
+    void rbTransplant(Node* u, Node* v) {
+        if (u->parent == nullptr) {
+            __atomic_store_n(&root, v, __ATOMIC_RELEASE);
+        }
+        else if (u == u->parent->left) {
+            __atomic_store_n(&u->parent->left, v, __ATOMIC_RELEASE);
+        }
+        else {
+            __atomic_store_n(&u->parent->right, v, __ATOMIC_RELEASE);
+        }
+        v->parent = u->parent;
+    }
+
+    bool deleteNodeHelper(Node* node, int key) {
+        Node* z = TNULL;
+        Node* x, * y;
+        while (node != TNULL) {
+            if (node->value == key) {
+                z = node;
+            }
+            if (node->value <= key) {
+                node = node->right;
+            }
+            else {
+                node = node->left;
+            }
+        }
+        if (z == TNULL) {
+            return false;
+        }
+        if (z->copies > 1) {
+            // Кратное значение: узел остаётся, меняются только сводки пути
+            --z->copies;
+            --total;
+            updateNodesUp(z);
+            return true;
+        }
+        y = z;
+        int y_original_color = y->color;
+        if (z->left == TNULL) {
+            x = z->right;
+            rbTransplant(z, z->right);
+        }
+        else if (z->right == TNULL) {
+            x = z->left;
+            rbTransplant(z, z->left);
+        }
+        else {
+            Restructure section(*this); // y переезжает на место z
+            y = minimum(z->right);
+            y_original_color = y->color;
+            x = y->right;
+            if (y->parent == z) {
+                x->parent = y;
+            }
+            else {
+                rbTransplant(y, y->right);
+                __atomic_store_n(&y->right, z->right, __ATOMIC_RELEASE);
+                y->right->parent = y;
+            }
+            rbTransplant(z, y);
+            __atomic_store_n(&y->left, z->left, __ATOMIC_RELEASE);
+            y->left->parent = y;
+            y->color = z->color;
+        }
+        updateNodesUp(x->parent);
+        destroyNode(z);
+        --total;
+        if (y_original_color == BLACK) {
+            fixDelete(x);
+        }
+        return true;
+    }
+
+    template <class It>
+    Node* buildBalanced(It& it, size_t n, int depth, int fullLevels, Node* parent) {
+        if (n == 0) {
+            return TNULL;
+        }
+        Node* node = createNode(0); // Значение — следующее после левого поддерева
+        node->parent = parent;
+        node->left = buildBalanced(it, n / 2, depth + 1, fullLevels, node);
+        node->value = *it;
+        ++it;
+        node->right = buildBalanced(it, n - n / 2 - 1, depth + 1, fullLevels, node);
+        node->color = depth < fullLevels ? BLACK : RED;
+        updateNode(node);
+        return node;
+    }
+
+    // Число полностью заполненных уровней идеально сбалансированного дерева из n узлов
+    static int fullLevelsFor(size_t n) {
+        int fullLevels = 0;
+        while ((size_t(2) << fullLevels) - 1 <= n) {
+            ++fullLevels;
+        }
+        return fullLevels;
+    }
+
+    // Связывает готовые узлы (по возрастанию) в сбалансированное дерево, как buildBalanced
+    Node* linkBalanced(Node** nodes, size_t n, int depth, int fullLevels, Node* parent) {
+        if (n == 0) {
+            return TNULL;
+        }
+        size_t mid = n / 2;
+        Node* node = nodes[mid];
+        node->parent = parent;
+        // Узлы могут быть старыми, и читатели ещё по ним ходят
+        __atomic_store_n(&node->left, linkBalanced(nodes, mid, depth + 1, fullLevels, node), __ATOMIC_RELEASE);
+        __atomic_store_n(&node->right, linkBalanced(nodes + mid + 1, n - mid - 1, depth + 1, fullLevels, node), __ATOMIC_RELEASE);
+        node->color = depth < fullLevels ? BLACK : RED;
+        updateNode(node);
+        return node;
+    }
+
+    void relink(std::vector<Node*>& nodes) {
+        Restructure section(*this);
+        __atomic_store_n(&root, linkBalanced(nodes.data(), nodes.size(), 0, fullLevelsFor(nodes.size()), nullptr), __ATOMIC_RELEASE);
+        total = root->stats.size;
+    }
+
+    // Узлы дерева по возрастанию
+    void collectNodes(std::vector<Node*>& nodes) {
+        nodes.reserve(nodes.size() + total);
+        std::vector<Node*> stack;
+        Node* current = root;
+        while (current != TNULL || !stack.empty()) {
+            while (current != TNULL) {
+                stack.push_back(current);
+                current = current->left;
+            }
+            current = stack.back();
+            stack.pop_back();
+            nodes.push_back(current);
+            current = current->right;
+        }
+    }
+
+    // Пакет из m ключей выгоднее слить с деревом и перестроить за O(n + m),
+    // чем делать m спусков по O(log n) с балансировкой
+    bool mergeIsCheaper(size_t m) {
+        return m * static_cast<size_t>(getHeight() + 1) >= total;
+    }
+
+    Node* minimum(Node* node) {
+        while (node->left != TNULL) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    Node* maximum(Node* node) {
+        while (node->right != TNULL) {
+            node = node->right;
+        }
+        return node;
+    }
+
+    // Следующий по возрастанию узел или TNULL
+    Node* successor(Node* node) {
+        if (node->right != TNULL) {
+            return minimum(node->right);
+        }
+        Node* p = node->parent;
+        while (p && node == p->right) {
+            node = p;
+            p = p->parent;
+        }
+        return p ? p : TNULL;
+    }
+
+    // Предыдущий узел или TNULL
+    Node* predecessor(Node* node) {
+        if (node->left != TNULL) {
+            return maximum(node->left);
+        }
+        Node* p = node->parent;
+        while (p && node == p->left) {
+            node = p;
+            p = p->parent;
+        }
+        return p ? p : TNULL;
+    }
+
+    // Первый узел со значением >= key (strict: > key) или TNULL
+    Node* bound(int key, bool strict) {
+        Node* found = TNULL;
+        Node* current = root;
+        while (current != TNULL) {
+            if (strict ? current->value > key : current->value >= key) {
+                found = current;
+                current = current->left;
+            }
+            else {
+                current = current->right;
+            }
+        }
+        return found;
+    }
+
+    // Поддерево для split и join: корень и чёрная высота (число чёрных узлов
+    // на пути от корня до TNULL, не считая TNULL). Узлы, которые участвуют
+    // в одной операции, ссылаются на один и тот же TNULL (shareSentinel)
+    struct Subtree {
+        Node* root;
+        int blackHeight;
+    };
+
+    enum SetOperation { kUnion, kIntersection, kDifference };
+
+    int blackHeightOf(Node* node) const {
+        int h = 0;
+        for (; node != TNULL; node = node->left) {
+            if (node->color == BLACK) ++h;
+        }
+        return h;
+    }
+
+    // Потомки узла с пересчётом высоты и сводки. TNULL не меняется: ветви
+    // параллельной операции пишут только в свои узлы
+    void linkChildren(Node* node, Node* left, Node* right) {
+        node->left = left;
+        node->right = right;
+        if (left != TNULL) left->parent = node;
+        if (right != TNULL) right->parent = node;
+        updateNode(node);
+    }
+
+    Subtree childSubtree(const Subtree& t, Node* child) const {
+        return Subtree{ child, t.blackHeight - (t.root->color == BLACK ? 1 : 0) };
+    }
+
+    // Красный корень перекрашивается в чёрный: чёрная высота растёт на 1
+    static void blacken(Subtree& t, Node* nil) {
+        if (t.root != nil && t.root->color == RED) {
+            t.root->color = BLACK;
+            ++t.blackHeight;
+        }
+    }
+
+    Node* rotateLeftAt(Node* node) {
+        Node* up = node->right;
+        linkChildren(node, node->left, up->left);
+        linkChildren(up, node, up->right);
+        return up;
+    }
+
+    Node* rotateRightAt(Node* node) {
+        Node* up = node->left;
+        linkChildren(node, up->right, node->right);
+        linkChildren(up, up->left, node);
+        return up;
+    }
+
+    // Спуск по правому краю node (чёрная высота h) до чёрного поддерева высоты
+    // right.blackHeight; там средний узел встаёт красным, а два красных подряд
+    // исправляются поворотом у ближайшего чёрного предка на обратном пути
+    Node* joinRight(Node* node, int h, Node* middle, const Subtree& right) {
+        if (node->color == BLACK && h == right.blackHeight) {
+            middle->color = RED;
+            linkChildren(middle, node, right.root);
+            return middle;
+        }
+        Node* child = joinRight(node->right, h - (node->color == BLACK ? 1 : 0), middle, right);
+        linkChildren(node, node->left, child);
+        if (node->color == BLACK && child->color == RED && child->right->color == RED) {
+            child->right->color = BLACK;
+            return rotateLeftAt(node);
+        }
+        return node;
+    }
+
+    Node* joinLeft(Node* node, int h, Node* middle, const Subtree& left) {
+        if (node->color == BLACK && h == left.blackHeight) {
+            middle->color = RED;
+            linkChildren(middle, left.root, node);
+            return middle;
+        }
+        Node* child = joinLeft(node->left, h - (node->color == BLACK ? 1 : 0), middle, left);
+        linkChildren(node, child, node->right);
+        if (node->color == BLACK && child->color == RED && child->left->color == RED) {
+            child->left->color = BLACK;
+            return rotateRightAt(node);
+        }
+        return node;
+    }
+
+    // join за O(|bh(left) - bh(right)| + 1): корни перекрашиваются в чёрный,
+    // средний узел подвешивается на уровне меньшего дерева
+    Subtree joinSubtrees(Subtree left, Node* middle, Subtree right) {
+        blacken(left, TNULL);
+        blacken(right, TNULL);
+        Subtree result;
+        if (left.blackHeight > right.blackHeight) {
+            result = Subtree{ joinRight(left.root, left.blackHeight, middle, right), left.blackHeight };
+        }
+        else if (right.blackHeight > left.blackHeight) {
+            result = Subtree{ joinLeft(right.root, right.blackHeight, middle, left), right.blackHeight };
+        }
+        else {
+            middle->color = RED;
+            linkChildren(middle, left.root, right.root);
+            result = Subtree{ middle, left.blackHeight };
+        }
+        result.root->parent = nullptr;
+        return result;
+    }
+
+    // join без среднего ключа: средним становится наибольший узел left
+    Subtree joinSubtrees(Subtree left, Subtree right) {
+        if (left.root == TNULL || right.root == TNULL) {
+            return left.root == TNULL ? right : left;
+        }
+        Node* last = nullptr;
+        left = removeLast(left, last);
+        return joinSubtrees(left, last, right);
+    }
+
+    // Отделяет наибольший узел: поддерево режется по его ключу
+    Subtree removeLast(Subtree t, Node*& last) {
+        Node* node = t.root;
+        while (node->right != TNULL) node = node->right;
+        Subtree left, right;
+        last = splitSubtree(t, node->value, left, right);
+        return left; // right пустое: больше наибольшего ключа ничего нет
+    }
+
+    // Разрезает поддерево по key; возвращает отцепленный узел с ключом key или nullptr
+    Node* splitSubtree(Subtree t, int key, Subtree& left, Subtree& right) {
+        if (t.root == TNULL) {
+            left = right = Subtree{ TNULL, 0 };
+            return nullptr;
+        }
+        Node* node = t.root;
+        Subtree l = childSubtree(t, node->left);
+        Subtree r = childSubtree(t, node->right);
+        if (key == node->value) {
+            left = l;
+            right = r;
+            return node;
+        }
+        if (key < node->value) {
+            Node* found = splitSubtree(l, key, left, l);
+            right = joinSubtrees(l, node, r);
+            return found;
+        }
+        Node* found = splitSubtree(r, key, r, right);
+        left = joinSubtrees(l, node, r);
+        return found;
+    }
+
+    // Корень b делит a пополам, половины обрабатываются независимо и, пока
+    // поддеревья крупные, в разных потоках. Лишние узлы собираются в dropped
+    Subtree setOperation(SetOperation op, Subtree a, Subtree b, int budget, std::vector<Node*>& dropped) {
+        if (a.root == TNULL || b.root == TNULL) {
+            Subtree empty{ TNULL, 0 };
+            Subtree kept = op == kUnion ? (a.root != TNULL ? a : b) : op == kDifference ? a : empty;
+            if (a.root != TNULL && a.root != kept.root) collectSubtree(a.root, dropped);
+            if (b.root != TNULL && b.root != kept.root) collectSubtree(b.root, dropped);
+            return kept;
+        }
+        bool fork = budget > 0 && a.root->stats.size + b.root->stats.size > kForkGrain;
+        Node* middle = b.root;
+        Subtree bLeft = childSubtree(b, middle->left);
+        Subtree bRight = childSubtree(b, middle->right);
+        Subtree aLeft, aRight;
+        Node* found = splitSubtree(a, middle->value, aLeft, aRight);
+        if (found) dropped.push_back(found);
+
+        Subtree left, right;
+        std::vector<Node*> droppedLeft;
+        forkJoin(fork,
+            [&]() { left = setOperation(op, aLeft, bLeft, budget - 1, droppedLeft); },
+            [&]() { right = setOperation(op, aRight, bRight, budget - 1, dropped); });
+        dropped.insert(dropped.end(), droppedLeft.begin(), droppedLeft.end());
+
+        if (op == kUnion || (op == kIntersection && found)) {
+            return joinSubtrees(left, middle, right);
+        }
+        dropped.push_back(middle);
+        return joinSubtrees(left, right);
+    }
+
+    void collectSubtree(Node* node, std::vector<Node*>& nodes) {
+        std::vector<Node*> stack(1, node);
+        while (!stack.empty()) {
+            Node* current = stack.back();
+            stack.pop_back();
+            nodes.push_back(current);
+            if (current->left != TNULL) stack.push_back(current->left);
+            if (current->right != TNULL) stack.push_back(current->right);
+        }
+    }
+
+    // После split или join: корень чёрный, без родителя, total — по сводке
+    void setRoot(Subtree t) {
+        root = t.root;
+        if (root != TNULL) {
+            root->parent = nullptr;
+            root->color = BLACK;
+        }
+        total = root->stats.size;
+    }
+
+    // Узлы другого дерева переводятся на TNULL этого. Перенаправляются листья
+    // меньшего дерева, O(его размера): если меньше это дерево, деревья сначала
+    // меняются фиктивными листьями. Корень other после этого обнуляет вызывающий код
+    void shareSentinel(RedBlackTree& other) {
+        checkSamePool(other);
+        if (total < other.total) {
+            std::swap(TNULL, other.TNULL);
+            retarget(root, other.TNULL, TNULL);
+        }
+        else {
+            retarget(other.root, other.TNULL, TNULL);
+        }
+    }
+
+    // Узлы одного дерева освобождаются через пул другого, поэтому пул должен быть общим
+    void checkSamePool(const RedBlackTree& other) const {
+        if (pool != other.pool) {
+            throw std::invalid_argument("RedBlackTree: у деревьев разные пулы узлов");
+        }
+    }
+
+    // Дерево с корнем node (или пустое, если node == from) переводится с листа from на to
+    void retarget(Node*& node, Node* from, Node* to) {
+        if (node == from) {
+            node = to;
+            return;
+        }
+        std::vector<Node*> stack(1, node);
+        while (!stack.empty()) {
+            Node* current = stack.back();
+            stack.pop_back();
+            if (current->left == from) {
+                current->left = to;
+            }
+            else {
+                stack.push_back(current->left);
+            }
+            if (current->right == from) {
+                current->right = to;
+            }
+            else {
+                stack.push_back(current->right);
+            }
+        }
+    }
+
+    // Операция над этим деревом и other; результат остаётся здесь, other пустеет
+    void applySetOperation(SetOperation op, RedBlackTree& other) {
+        shareSentinel(other);
+        std::vector<Node*> dropped;
+        Subtree a{ root, blackHeightOf(root) };
+        Subtree b{ other.root, blackHeightOf(other.root) };
+        other.root = other.TNULL;
+        other.total = 0;
+        setRoot(setOperation(op, a, b, forkBudget(), dropped));
+        for (Node* node : dropped) destroyNode(node);
+    }
+
+public:
+    explicit RedBlackTree(Pool* nodePool = nullptr) : pool(nodePool), total(0), version(0) {
+        TNULL = new Node(0);
+        TNULL->color = BLACK;
+        TNULL->height = 0;
+        TNULL->stats = SubtreeStats();
+        TNULL->left = nullptr;
+        TNULL->right = nullptr;
+        root = TNULL;
+    }
+
+    ~RedBlackTree() {
+        clear();
+        delete TNULL;
+    }
+
+    // Удаляем все узлы. Узлы из пула не обходим: их память вернёт pool->release()
+    void clear() {
+        Restructure section(*this);
+        if (epochs) {
+            std::vector<Node*> nodes;
+            collectNodes(nodes);
+            __atomic_store_n(&root, TNULL, __ATOMIC_RELEASE);
+            for (Node* node : nodes) destroyNode(node);
+        }
+        else if (!pool) {
+            deleteTree(root);
+        }
+        __atomic_store_n(&root, TNULL, __ATOMIC_RELEASE);
+        total = 0;
+    }
+
+    // Включает режим, в котором concurrentSearch можно вызывать из любых потоков
+    // без блокировок, пока один писатель меняет дерево. Вызывается до запуска
+    // читателей. Писатели по-прежнему должны быть упорядочены вызывающим кодом.
+    // Узлы из пула в этом режиме нельзя освобождать pool->release(), пока жив
+    // домен эпох: в нём могут ждать удаления узлы из этого пула
+    void enableConcurrentReads() {
+        if (!epochs) epochs.reset(new EpochDomain());
+    }
+
+    // Поиск без блокировок. Читатель держит эпоху, так что узлы, до которых он
+    // дошёл, не освобождаются. Значение узла после вставки не меняется, поэтому
+    // найденный ключ — верный ответ. Отсутствие ключа проверяется по version:
+    // если за время спуска узлы переставлялись, спуск повторяется.
+    // Без enableConcurrentReads — обычный спуск, и писателей рядом быть не должно
+    bool concurrentSearch(int key) const {
+        if (!epochs) {
+            const Node* current = root;
+            while (current != TNULL && current->value != key) {
+                current = key < current->value ? current->left : current->right;
+            }
+            return current != TNULL;
+        }
+        EpochDomain::Guard guard(*epochs);
+        while (true) {
+            uint64_t before = version.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield(); // Писатель посреди поворота
+                continue;
+            }
+            const Node* current = __atomic_load_n(&root, __ATOMIC_ACQUIRE);
+            int steps = 0;
+            while (current != TNULL && steps++ < kMaxReadSteps) {
+                int value = current->value;
+                if (value == key) {
+                    return true;
+                }
+                current = key < value ? __atomic_load_n(&current->left, __ATOMIC_ACQUIRE)
+                                      : __atomic_load_n(&current->right, __ATOMIC_ACQUIRE);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (steps <= kMaxReadSteps && version.load(std::memory_order_relaxed) == before) {
+                return false;
+            }
+        }
+    }
+
+    size_t size() const {
+        return total;
+    }
+
+    // Заменяет содержимое деревом из отсортированного диапазона за O(n) без fixInsert.
+    // Дерево строится идеально сбалансированным: все уровни, кроме последнего,
+    // заполнены и чёрные, узлы неполного последнего уровня — красные
+    template <class It>
+    void buildFromSorted(It first, It last) {
+        clear();
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        __atomic_store_n(&root, buildBalanced(first, n, 0, fullLevelsFor(n), nullptr), __ATOMIC_RELEASE);
+        total = n;
+    }
+
+    // Пакетная вставка. Ключи сортируются; небольшой пакет вставляется по порядку
+    // (соседние ключи идут почти одним путём, который уже в кэше), а крупный
+    // сливается с деревом за один проход: узлы дерева переиспользуются,
+    // новые создаются только для ключей пакета, и дерево перестраивается без fixInsert
+    void insertBatch(std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        if (!mergeIsCheaper(keys.size())) {
+            for (int k : keys) insert(k);
+            return;
+        }
+
+        std::vector<Node*> nodes;
+        collectNodes(nodes);
+        std::vector<Node*> merged;
+        merged.reserve(nodes.size() + keys.size());
+        size_t i = 0;
+        for (int k : keys) {
+            // Равные ключи встают после существующих, как при обычной вставке
+            while (i < nodes.size() && nodes[i]->value <= k) {
+                merged.push_back(nodes[i++]);
+            }
+            merged.push_back(createNode(k));
+        }
+        merged.insert(merged.end(), nodes.begin() + i, nodes.end());
+        relink(merged);
+    }
+
+    // Пакетное удаление: по одному вхождению на каждый ключ пакета,
+    // отсутствующие ключи пропускаются. Стратегия та же, что у insertBatch;
+    // кратный узел удаляется, только когда его кратность дошла до нуля
+    void deleteBatch(std::vector<int> keys) {
+        std::sort(keys.begin(), keys.end());
+        if (!mergeIsCheaper(keys.size())) {
+            for (int k : keys) deleteNodeHelper(root, k);
+            return;
+        }
+
+        std::vector<Node*> nodes;
+        collectNodes(nodes);
+        std::vector<Node*> kept;
+        kept.reserve(nodes.size());
+        size_t j = 0;
+        for (Node* node : nodes) {
+            while (j < keys.size() && keys[j] < node->value) ++j;
+            while (j < keys.size() && keys[j] == node->value && node->copies > 0) {
+                --node->copies;
+                ++j;
+            }
+            if (node->copies == 0) {
+                destroyNode(node);
+            }
+            else {
+                kept.push_back(node);
+            }
+        }
+        relink(kept);
+    }
+
+    // split и join (Blelloch, Ferizovic, Sun, 2016) и операции над множествами
+    // на них: объединение, пересечение и разность за O(m log(n / m + 1)), m <= n,
+    // половины рекурсии идут параллельно (ForkJoin.h). Узлы переходят из дерева
+    // в дерево без копирования; другое дерево после вызова пустое.
+    // Чтобы узлы обоих деревьев ссылались на один TNULL, листья меньшего
+    // перенаправляются — ещё O(m). Ключи в каждом дереве не должны повторяться,
+    // пул узлов у деревьев общий (или у обоих его нет); не для режима
+    // enableConcurrentReads
+
+    // Здесь остаются ключи меньше key, в right (прежнее содержимое удаляется)
+    // переходят большие. Узел с ключом key удаляется; возвращает, был ли он
+    bool split(int key, RedBlackTree& right) {
+        checkSamePool(right);
+        right.clear();
+        Subtree left, greater;
+        Node* found = splitSubtree(Subtree{ root, blackHeightOf(root) }, key, left, greater);
+        if (found) destroyNode(found);
+        setRoot(left);
+        // Обе части ссылаются на TNULL этого дерева: листья меньшей переводим
+        // на лист right (или меняемся листьями и переводим эту часть)
+        if (total < static_cast<size_t>(greater.root->stats.size)) {
+            std::swap(TNULL, right.TNULL);
+            retarget(root, right.TNULL, TNULL);
+        }
+        else {
+            retarget(greater.root, TNULL, right.TNULL);
+        }
+        right.setRoot(greater);
+        return found != nullptr;
+    }
+
+    // Сюда добавляются key и все ключи right; ключи этого дерева не больше key,
+    // ключи right не меньше. right пустеет
+    void join(int key, RedBlackTree& right) {
+        shareSentinel(right);
+        Node* middle = createNode(key);
+        Subtree greater{ right.root, blackHeightOf(right.root) };
+        right.root = right.TNULL;
+        right.total = 0;
+        setRoot(joinSubtrees(Subtree{ root, blackHeightOf(root) }, middle, greater));
+    }
+
+    void unionWith(RedBlackTree& other) {
+        applySetOperation(kUnion, other);
+    }
+
+    void intersectionWith(RedBlackTree& other) {
+        applySetOperation(kIntersection, other);
+    }
+
+    // Разность: здесь остаются ключи, которых нет в other
+    void differenceWith(RedBlackTree& other) {
+        applySetOperation(kDifference, other);
+    }
+
+    void insert(const int& key) {
+        insertValue(key, false);
+    }
+
+    // Вставка в режиме мультимножества: повтор значения увеличивает кратность
+    // его узла — без нового узла и без fixInsert, меняются только сводки пути
+    void insertCounted(int key) {
+        insertValue(key, true);
+    }
+
+    // Сколько раз встречается key (с учётом кратностей)
+    int count(int key) {
+        return countOf(root, key, TNULL);
+    }
+
+    void insertValue(int key, bool counted) {
+        Node* y = nullptr;
+        Node* x = this->root;
+
+        while (x != TNULL) {
+            if (counted && x->value == key) {
+                ++x->copies;
+                ++total;
+                updateNodesUp(x);
+                return;
+            }
+            y = x;
+            if (key < x->value) {
+                x = x->left;
+            }
+            else {
+                x = x->right;
+            }
+        }
+
+        Node* pt = createNode(key);
+        ++total;
+        pt->parent = nullptr;
+        pt->value = key;
+        pt->left = TNULL;
+        pt->right = TNULL;
+        pt->color = RED;
+
+        // Узел публикуется с release: конкурентный читатель увидит его поля заполненными
+        pt->parent = y;
+        if (y == nullptr) {
+            __atomic_store_n(&root, pt, __ATOMIC_RELEASE);
+        }
+        else if (pt->value < y->value) {
+            __atomic_store_n(&y->left, pt, __ATOMIC_RELEASE);
+        }
+        else {
+            __atomic_store_n(&y->right, pt, __ATOMIC_RELEASE);
+        }
+        updateNodesUp(y);
+
+        if (pt->parent == nullptr) {
+            pt->color = BLACK;
+            return;
+        }
+
+        if (pt->parent->parent == nullptr) {
+            return;
+        }
+
+        fixInsert(pt);
+    }
+
+    // Удаляет одно вхождение value; false, если его нет. Ничего не печатает:
+    // промахи удаления — обычное дело для смешанной нагрузки
+    bool erase(int value) {
+        return deleteNodeHelper(this->root, value);
+    }
+
+    void deleteNode(int value) {
+        if (!erase(value)) {
+            std::cout << "Key not found in the tree" << std::endl;
+        }
+    }
+
+    Node* search(int value) {
+        Node* current = root;
+        int descended = 0; // Для TreeStats.h; без TREE_STATS компилятор его выбросит
+        while (current != TNULL) {
+            if (value == current->value) {
+                treestats::searched(descended, true);
+                return current;
+            }
+            else if (value < current->value) {
+                current = current->left;
+            }
+            else {
+                current = current->right;
+            }
+            ++descended;
+        }
+        treestats::searched(descended, false);
+        return nullptr;
+    }
+
+    // Пакетный поиск: results[i] — найдено ли keys[i]; поиски идут вперемешку
+    // с предвыборкой, чтобы промахи кэша перекрывались
+    void searchBatch(const int* keys, size_t n, bool* results) const {
+        searchInterleaved(root, keys, n, results, TNULL);
+    }
+
+    // Неизменяемый снимок для поиска без указателей: один симметричный обход
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        sorted.reserve(total);
+        inorder([&sorted](const Node* node) { sorted.insert(sorted.end(), node->copies, node->value); });
+        return FrozenTree(sorted);
+    }
+
+    // Двунаправленный итератор по возрастанию: шаги идут по указателям на
+    // родителя, поэтому итератор занимает два указателя и не выделяет память.
+    // Кратный узел — один шаг, его кратность — node()->copies.
+    // Вставка и удаление делают итераторы недействительными.
+    class Iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef int value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const int* pointer;
+        typedef const int& reference;
+
+        Iterator() : tree(nullptr), current(nullptr) {}
+
+        reference operator*() const { return current->value; }
+        pointer operator->() const { return &current->value; }
+
+        // Текущий узел или nullptr для end()
+        Node* node() const { return current; }
+
+        Iterator& operator++() {
+            current = tree->wrap(tree->successor(current));
+            return *this;
+        }
+
+        // --end() переходит к максимуму
+        Iterator& operator--() {
+            if (current) {
+                current = tree->wrap(tree->predecessor(current));
+            }
+            else if (tree->root != tree->TNULL) {
+                current = tree->maximum(tree->root);
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        Iterator operator--(int) {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const { return current == other.current; }
+        bool operator!=(const Iterator& other) const { return current != other.current; }
+
+    private:
+        friend class RedBlackTree;
+
+        Iterator(RedBlackTree* owner, Node* node) : tree(owner), current(owner->wrap(node)) {}
+
+        RedBlackTree* tree;
+        Node* current;
+    };
+
+    Iterator begin() {
+        return Iterator(this, root == TNULL ? TNULL : minimum(root));
+    }
+
+    Iterator end() {
+        return Iterator(this, TNULL);
+    }
+
+    // Первый узел со значением >= key
+    Iterator lowerBound(int key) {
+        return Iterator(this, bound(key, false));
+    }
+
+    // Первый узел со значением > key
+    Iterator upperBound(int key) {
+        return Iterator(this, bound(key, true));
+    }
+
+    // Значения из отрезка [lo, hi] по возрастанию: for (int v : tree.range(lo, hi))
+    IteratorRange<Iterator> range(int lo, int hi) {
+        if (lo > hi) {
+            return IteratorRange<Iterator>(end(), end());
+        }
+        return IteratorRange<Iterator>(lowerBound(lo), upperBound(hi));
+    }
+
+    // Вызывает visit(value) для значений из [lo, hi] по возрастанию,
+    // кратное значение — copies раз
+    template <class F>
+    void scan(int lo, int hi, F visit) {
+        for (Node* node = bound(lo, false); node != TNULL && node->value <= hi; node = successor(node)) {
+            for (int i = node->copies; i > 0; --i) visit(node->value);
+        }
+    }
+
+    // Обходы с посетителем: visit(Node*) для каждого узла, без ввода-вывода.
+    // Листья TNULL не посещаются
+    template <class Visitor>
+    void preorder(Visitor&& visit) {
+        visitPreorder(root, visit, TNULL);
+    }
+
+    template <class Visitor>
+    void inorder(Visitor&& visit) {
+        visitInorder(root, visit, TNULL);
+    }
+
+    template <class Visitor>
+    void postorder(Visitor&& visit) {
+        visitPostorder(root, visit, TNULL);
+    }
+
+    template <class Visitor>
+    void levelOrder(Visitor&& visit) {
+        visitLevelOrder(root, visit, TNULL);
+    }
+
+    // Печать обходов через буферизованный вывод
+    void inorder() {
+        BufferedWriter out(std::cout);
+        inorder(PrintVisitor<Node>(out));
+    }
+
+    void preorder() {
+        BufferedWriter out(std::cout);
+        preorder(PrintVisitor<Node>(out));
+    }
+
+    void postorder() {
+        BufferedWriter out(std::cout);
+        postorder(PrintVisitor<Node>(out));
+    }
+
+    void levelOrder() {
+        BufferedWriter out(std::cout);
+        levelOrder(PrintVisitor<Node>(out));
+    }
+
+    // Число значений, меньших key
+    int rank(int key) {
+        return rankOf(root, key, TNULL);
+    }
+
+    // Узел с k-м по возрастанию значением (k с нуля) или nullptr
+    Node* select(int k) {
+        return wrap(selectNode(root, k, TNULL));
+    }
+
+    // Число, сумма, минимум и максимум значений из [lo, hi]
+    SubtreeStats rangeAggregate(int lo, int hi) {
+        return aggregateRange(root, lo, hi, TNULL);
+    }
+
+    // O(1): высота хранится в узле и обновляется при вставке, удалении и поворотах
+    int getHeight(Node* node) {
+        return node ? node->height : 0;
+    }
+
+    int getHeight() {
+        return root->height;
+    }
+
+private:
+    // TNULL снаружи выглядит как nullptr (end())
+    Node* wrap(Node* node) {
+        return node == TNULL ? nullptr : node;
+    }
+
+    void deleteTree(Node* node) {
+        if (node && node != TNULL) {
+            deleteTree(node->left);
+            deleteTree(node->right);
+            delete node;
+        }
+    }
+};
+
+} // namespace rb
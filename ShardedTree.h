@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrozenTree.h"
+
+// Дерево, разбитое по диапазонам ключей на P шардов. Каждый шард — отдельный
+// движок из Engines.h (AVLEngine, RBEngine) и принадлежит своему рабочему
+// потоку: пакеты раскладываются по шардам и применяются всеми потоками
+// параллельно, каждый поток трогает только свой шард, поэтому блокировок
+// внутри деревьев нет.
+//
+// Шард i хранит ключи из [splitters[i - 1], splitters[i]). Границы выбираются
+// по квантилям первого пакета (или ключей buildFromSorted), пока дерево пусто,
+// иначе ключ-пространство int делится поровну.
+//
+// Одиночные insert / search / remove и сканы выполняются в вызывающем потоке:
+// рабочие потоки в это время стоят, а передача задач идёт через мьютекс,
+// так что шард всегда видит последнюю запись. Сам ShardedTree вызывается
+// из одного потока.
+template <class Shard>
+class ShardedTree {
+public:
+    // shards <= 0 — по числу ядер
+    explicit ShardedTree(bool usePool = false, int shards = 0)
+        : stop(false), generation(0), pending(0) {
+        if (shards <= 0) {
+            shards = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        for (int i = 0; i < shards; ++i) {
+            trees.emplace_back(new Shard(usePool));
+        }
+        parts.resize(shards);
+        partIndex.resize(shards);
+        splitEvenly();
+        for (int i = 0; i < shards; ++i) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~ShardedTree() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    static const char* name() {
+        static const std::string n = std::string("sharded-") + Shard::name();
+        return n.c_str();
+    }
+
+    int shardCount() const {
+        return static_cast<int>(trees.size());
+    }
+
+    void insert(int key) { trees[shardOf(key)]->insert(key); }
+    bool search(int key) { return trees[shardOf(key)]->search(key); }
+    void remove(int key) { trees[shardOf(key)]->remove(key); }
+
+    void insertBatch(const std::vector<int>& keys) {
+        if (empty()) {
+            splitByQuantiles(keys);
+        }
+        partition(keys.data(), keys.size(), false);
+        runOnShards([this](int i) {
+            if (!parts[i].empty()) trees[i]->insertBatch(parts[i]);
+        });
+    }
+
+    void removeBatch(const std::vector<int>& keys) {
+        partition(keys.data(), keys.size(), false);
+        runOnShards([this](int i) {
+            if (!parts[i].empty()) trees[i]->removeBatch(parts[i]);
+        });
+    }
+
+    // Каждый шард ищет свою часть пакета и раскладывает ответы по исходным местам
+    void searchBatch(const int* keys, size_t n, bool* results) {
+        partition(keys, n, true);
+        runOnShards([this, results](int i) {
+            size_t m = parts[i].size();
+            if (m == 0) {
+                return;
+            }
+            std::unique_ptr<bool[]> found(new bool[m]);
+            trees[i]->searchBatch(parts[i].data(), m, found.get());
+            for (size_t j = 0; j < m; ++j) results[partIndex[i][j]] = found[j];
+        });
+    }
+
+    // Отсортированные ключи режутся на P равных кусков, шарды строятся параллельно
+    void buildFromSorted(const std::vector<int>& keys) {
+        clear();
+        splitByQuantiles(keys);
+        partition(keys.data(), keys.size(), false);
+        runOnShards([this](int i) { trees[i]->buildFromSorted(parts[i]); });
+    }
+
+    // Ключи из [lo, hi] по возрастанию: шарды, пересекающие отрезок, обходятся по порядку
+    template <class Visit>
+    void forEachInRange(int lo, int hi, Visit visit) {
+        if (lo > hi) {
+            return;
+        }
+        for (int i = shardOf(lo); i < shardCount(); ++i) {
+            if (i > 0 && splitters[i - 1] > hi) {
+                break;
+            }
+            trees[i]->forEachInRange(lo, hi, visit);
+        }
+    }
+
+    long long scan(int lo, int hi) {
+        long long visited = 0;
+        forEachInRange(lo, hi, [&visited](int) { ++visited; });
+        return visited;
+    }
+
+    int height() {
+        int h = 0;
+        for (const std::unique_ptr<Shard>& tree : trees) h = std::max(h, tree->height());
+        return h;
+    }
+
+    FrozenTree freeze() {
+        std::vector<int> sorted;
+        forEachInRange(INT_MIN, INT_MAX, [&sorted](int k) { sorted.push_back(k); });
+        return FrozenTree(sorted);
+    }
+
+    void clear() {
+        runOnShards([this](int i) { trees[i]->clear(); });
+    }
+
+private:
+    std::vector<std::unique_ptr<Shard>> trees;
+    std::vector<int> splitters;                  // Нижние границы шардов 1 .. P - 1
+    std::vector<std::vector<int>> parts;         // Часть текущего пакета для каждого шарда
+    std::vector<std::vector<size_t>> partIndex;  // Места этих ключей в пакете (для searchBatch)
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    std::function<void(int)> job;
+    bool stop;
+    uint64_t generation;                         // Номер текущей задачи
+    int pending;                                 // Сколько потоков её ещё выполняют
+
+    int shardOf(int key) const {
+        return static_cast<int>(std::upper_bound(splitters.begin(), splitters.end(), key) - splitters.begin());
+    }
+
+    // Высота у движков хранится в корне, проверка дешёвая
+    bool empty() {
+        for (const std::unique_ptr<Shard>& tree : trees) {
+            if (tree->height() != 0) return false;
+        }
+        return true;
+    }
+
+    void splitEvenly() {
+        splitters.clear();
+        long long width = (static_cast<long long>(INT_MAX) - INT_MIN + 1) / shardCount();
+        for (int i = 1; i < shardCount(); ++i) {
+            splitters.push_back(static_cast<int>(INT_MIN + width * i));
+        }
+    }
+
+    // Границы — квантили ключей, чтобы шарды получили поровну
+    void splitByQuantiles(const std::vector<int>& keys) {
+        if (keys.empty()) {
+            splitEvenly();
+            return;
+        }
+        std::vector<int> sample(keys);
+        splitters.clear();
+        for (int i = 1; i < shardCount(); ++i) {
+            std::vector<int>::iterator q = sample.begin() + sample.size() * i / shardCount();
+            std::nth_element(sample.begin(), q, sample.end());
+            splitters.push_back(*q);
+        }
+        std::sort(splitters.begin(), splitters.end());
+    }
+
+    // Раскладывает пакет по шардам с сохранением порядка ключей внутри шарда
+    void partition(const int* keys, size_t n, bool withIndex) {
+        for (int i = 0; i < shardCount(); ++i) {
+            parts[i].clear();
+            partIndex[i].clear();
+        }
+        for (size_t j = 0; j < n; ++j) {
+            int i = shardOf(keys[j]);
+            parts[i].push_back(keys[j]);
+            if (withIndex) partIndex[i].push_back(j);
+        }
+    }
+
+    // Выполняет f(i) в потоке каждого шарда i и ждёт, пока закончат все
+    void runOnShards(std::function<void(int)> f) {
+        std::unique_lock<std::mutex> lock(mutex);
+        job = std::move(f);
+        pending = shardCount();
+        ++generation;
+        start.notify_all();
+        done.wait(lock, [this]() { return pending == 0; });
+        job = nullptr;
+    }
+
+    void workerLoop(int shard) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            start.wait(lock, [&]() { return stop || generation != seen; });
+            if (stop) {
+                return;
+            }
+            seen = generation;
+            lock.unlock();
+            job(shard);
+            lock.lock();
+            if (--pending == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    ShardedTree(const ShardedTree&) = delete;
+    ShardedTree& operator=(const ShardedTree&) = delete;
+};
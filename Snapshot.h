@@ -0,0 +1,265 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AVL.h"
+#include "FrozenTree.h"
+#include "MappedFile.h"
+#include "RB.h"
+
+namespace snapshot {
+
+// Снимок AVL- или красно-чёрного дерева на диске, который открывается через
+// mmap и сразу годится для поиска: узлы читаются прямо из отображённого
+// файла, ничего не копируется и не перестраивается. Вместо минут повторных
+// insert при старте — отображение файла и проверка контрольной суммы.
+//
+// Формат (порядок байтов — как в памяти, записан в заголовке):
+//   Header — 64 байта: магия, версия формата, вид дерева, число узлов,
+//   высота, контрольная сумма массива узлов;
+//   Node[count] — узлы в прямом порядке (preorder): корень — узел 0, левый
+//   потомок лежит сразу за родителем, правый — после всего левого поддерева.
+// Ссылки на потомков — номера узлов в массиве (смещения в 16-байтовых узлах),
+// а не указатели, поэтому файл не зависит от адреса отображения. 0 означает
+// «потомка нет»: корень ничьим потомком не бывает.
+
+enum Kind { AVL = 1, RED_BLACK = 2 };
+
+const char kMagic[8] = { 'T', 'R', 'E', 'E', 'S', 'N', 'A', 'P' };
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+
+struct Node {
+    int32_t value;
+    uint32_t left;
+    uint32_t right;
+    int32_t meta;       // Высота у AVL, цвет у красно-чёрного (rb::RED, rb::BLACK)
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;      // Kind
+    uint64_t count;     // Число узлов
+    uint32_t nodeSize;  // sizeof(Node): файл с другой раскладкой не откроется
+    uint32_t height;
+    uint64_t checksum;  // checksum() массива узлов
+    uint32_t byteOrder; // kByteOrder как есть: на машине с другим порядком не совпадёт
+    uint8_t reserved[20];
+};
+
+static_assert(sizeof(Node) == 16, "узел снимка — 16 байт");
+static_assert(sizeof(Header) == 64, "заголовок снимка — 64 байта");
+
+// FNV-1a по 8-байтовым словам: слово за шаг вместо байта. Умножение на
+// нечётное число обратимо, поэтому порча любого одного слова меняет сумму
+inline uint64_t checksum(const void* data, size_t bytes) {
+    const uint64_t kPrime = 1099511628211ull;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        h = (h ^ word) * kPrime;
+    }
+    for (; i < bytes; ++i) h = (h ^ p[i]) * kPrime;
+    return h;
+}
+
+// Раскладывает дерево в прямом порядке. preorder(visit) обходит узлы дерева,
+// метаданные узла берёт meta(node); размеры поддеревьев — из stats.size
+// (у TNULL красно-чёрного дерева он 0, так что фиктивный лист — «нет потомка»).
+// Кратности в формате нет: дерево после insertCounted с повторами не пишется
+template <class TreeNode, class Preorder, class Meta>
+void writeTree(const std::string& path, Kind kind, int height, Preorder preorder, Meta meta) {
+    std::vector<Node> nodes;
+    preorder([&](const TreeNode* node) {
+        if (node->copies != 1) {
+            throw fileError(path, "кратные значения в снимок не пишутся");
+        }
+        uint32_t i = static_cast<uint32_t>(nodes.size());
+        uint32_t leftSize = node->left ? node->left->stats.size : 0;
+        uint32_t rightSize = node->right ? node->right->stats.size : 0;
+        Node disk;
+        disk.value = node->value;
+        disk.left = leftSize ? i + 1 : 0;
+        disk.right = rightSize ? i + 1 + leftSize : 0;
+        disk.meta = meta(node);
+        nodes.push_back(disk);
+    });
+    if (nodes.size() > UINT32_MAX) {
+        throw fileError(path, "больше 2^32 узлов");
+    }
+
+    size_t nodeBytes = nodes.size() * sizeof(Node);
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.kind = kind;
+    header.count = nodes.size();
+    header.nodeSize = sizeof(Node);
+    header.height = static_cast<uint32_t>(height);
+    header.checksum = checksum(nodes.data(), nodeBytes);
+    header.byteOrder = kByteOrder;
+
+    std::vector<char> bytes(sizeof(Header) + nodeBytes);
+    std::memcpy(bytes.data(), &header, sizeof(Header));
+    if (nodeBytes) std::memcpy(bytes.data() + sizeof(Header), nodes.data(), nodeBytes);
+    writeFileAtomically(path, bytes);
+}
+
+// root может быть nullptr — снимок пустого дерева
+inline void write(const std::string& path, avl::Node* root) {
+    writeTree<avl::Node>(path, AVL, root ? root->getHeight() : 0,
+        [root](auto visit) { if (root) root->preorder(visit); },
+        [](const avl::Node* node) { return node->height; });
+}
+
+inline void write(const std::string& path, rb::RedBlackTree& tree) {
+    writeTree<rb::Node>(path, RED_BLACK, tree.getHeight(),
+        [&tree](auto visit) { tree.preorder(visit); },
+        [](const rb::Node* node) { return static_cast<int32_t>(node->color); });
+}
+
+// Снимок, отображённый в память только для чтения (MappedFile). Поиск
+// и обход идут прямо по страницам файла.
+//
+// verify = true читает весь файл: сверяет контрольную сумму и проверяет,
+// что ссылки образуют дерево в прямом порядке (обход тогда всегда конечен).
+// Это O(n), но без выделения узлов и в разы быстрее перестроения.
+// С verify = false открытие — O(1), и файлу приходится доверять
+class MappedTree {
+public:
+    explicit MappedTree(const std::string& path, bool verify = true) : file(path) {
+        if (file.size() < sizeof(Header)) {
+            throw fileError(path, "файл короче заголовка снимка");
+        }
+        header = reinterpret_cast<const Header*>(file.data());
+        nodes = reinterpret_cast<const Node*>(file.data() + sizeof(Header));
+        validate(path, verify);
+    }
+
+    Kind kind() const { return static_cast<Kind>(header->kind); }
+    size_t size() const { return static_cast<size_t>(header->count); }
+    int height() const { return static_cast<int>(header->height); }
+
+    bool contains(int key) const {
+        if (header->count == 0) {
+            return false;
+        }
+        uint32_t i = 0;
+        while (true) {
+            const Node& node = nodes[i];
+            if (node.value == key) {
+                return true;
+            }
+            i = key < node.value ? node.left : node.right;
+            if (i == 0) {
+                return false;
+            }
+        }
+    }
+
+    // Значения из [lo, hi] по возрастанию
+    template <class Visit>
+    void scan(int lo, int hi, Visit visit) const {
+        std::vector<uint32_t> stack;
+        uint32_t current = header->count ? 0 : kNone;
+        while (current != kNone || !stack.empty()) {
+            while (current != kNone) {
+                // Левое поддерево нужно, только если в нём могут быть значения >= lo
+                stack.push_back(current);
+                current = nodes[current].value >= lo ? link(nodes[current].left) : kNone;
+            }
+            current = stack.back();
+            stack.pop_back();
+            int v = nodes[current].value;
+            if (v > hi) {
+                return;
+            }
+            if (v >= lo) visit(v);
+            current = link(nodes[current].right);
+        }
+    }
+
+    // Все значения по возрастанию: из них buildFromSorted за O(n) восстанавливает
+    // изменяемое дерево, если после старта нужны и записи
+    std::vector<int> sorted() const {
+        std::vector<int> values;
+        values.reserve(size());
+        scan(INT_MIN, INT_MAX, [&values](int v) { values.push_back(v); });
+        return values;
+    }
+
+    FrozenTree freeze() const {
+        return FrozenTree(sorted());
+    }
+
+private:
+    static const uint32_t kNone = UINT32_MAX; // «Нет узла» при обходе: номер 0 — это корень
+
+    MappedFile file;
+    const Header* header;
+    const Node* nodes;
+
+    static uint32_t link(uint32_t i) {
+        return i == 0 ? kNone : i;
+    }
+
+    void validate(const std::string& path, bool verify) const {
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+            throw fileError(path, "не снимок дерева");
+        }
+        if (header->byteOrder != kByteOrder) {
+            throw fileError(path, "другой порядок байтов");
+        }
+        if (header->version != kVersion) {
+            throw fileError(path, "неподдерживаемая версия формата " + std::to_string(header->version));
+        }
+        if (header->nodeSize != sizeof(Node) || (header->kind != AVL && header->kind != RED_BLACK)) {
+            throw fileError(path, "повреждённый заголовок");
+        }
+        if (header->count > UINT32_MAX || file.size() != sizeof(Header) + header->count * sizeof(Node)) {
+            throw fileError(path, "размер файла не совпадает с числом узлов");
+        }
+        if (!verify) {
+            return;
+        }
+        if (checksum(nodes, header->count * sizeof(Node)) != header->checksum) {
+            throw fileError(path, "контрольная сумма не совпадает");
+        }
+        // Прямой обход по ссылкам должен пройти узлы ровно в порядке массива:
+        // тогда каждый узел достижим один раз и циклов нет
+        uint32_t count = static_cast<uint32_t>(header->count);
+        uint32_t expected = 0;
+        std::vector<uint32_t> stack;
+        if (count) stack.push_back(0);
+        while (!stack.empty()) {
+            uint32_t i = stack.back();
+            stack.pop_back();
+            if (i != expected++) {
+                throw fileError(path, "узлы не в прямом порядке");
+            }
+            if (nodes[i].left >= count || nodes[i].right >= count) {
+                throw fileError(path, "ссылка на узел вне массива");
+            }
+            if (nodes[i].right) stack.push_back(nodes[i].right);
+            if (nodes[i].left) stack.push_back(nodes[i].left);
+        }
+        if (expected != count) {
+            throw fileError(path, "недостижимые узлы");
+        }
+    }
+
+    MappedTree(const MappedTree&) = delete;
+    MappedTree& operator=(const MappedTree&) = delete;
+};
+
+} // namespace snapshot
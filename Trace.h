@@ -0,0 +1,194 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace trace {
+
+// Трасса нагрузки: поток операций insert / search / remove / scan с ключами.
+// Её можно записать из любого прогона и повторить на любом движке — прогоны
+// становятся сравнимыми, а ключи из боевой системы можно прогнать через деревья.
+//
+// Формат (порядок байтов — как в памяти, записан в заголовке):
+//   Header — 64 байта: магия, версия, число записей;
+//   int32 keys[count] — ключи подряд (выровнены по 4 байтам);
+//   uint8 ops[count] — коды операций Op.
+// Итого 5 байт на операцию. Reader отображает файл через mmap, и повтор
+// читает ключи прямо со страниц файла: ввода-вывода в замере нет.
+
+// У SCAN в записи только начало диапазона; длину задаёт тот, кто повторяет трассу
+enum Op { INSERT = 0, SEARCH = 1, REMOVE = 2, SCAN = 3 };
+
+const int kOpCount = 4;
+const char kMagic[8] = { 'T', 'R', 'E', 'E', 'T', 'R', 'C', 'E' };
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;  // kByteOrder как есть: на машине с другим порядком не совпадёт
+    uint64_t count;      // Число записей
+    uint8_t reserved[40];
+};
+
+static_assert(sizeof(Header) == 64, "заголовок трассы — 64 байта");
+
+// Выполняет одну операцию трассы на движке (интерфейс Engines.h);
+// для поиска возвращает, найден ли ключ, для скана — нашлось ли что-нибудь
+// в [key, key + scanLength)
+template <class Engine>
+bool apply(Engine& engine, Op op, int key, int scanLength = 100) {
+    switch (op) {
+    case INSERT:
+        engine.insert(key);
+        return false;
+    case SEARCH:
+        return engine.search(key);
+    case REMOVE:
+        engine.remove(key);
+        return false;
+    case SCAN:
+        return engine.scan(key, key > INT_MAX - scanLength ? INT_MAX : key + scanLength - 1) != 0;
+    }
+    return false;
+}
+
+// Копит операции в памяти и пишет трассу одной последовательной записью
+class Writer {
+public:
+    void record(Op op, int key) {
+        keys.push_back(key);
+        ops.push_back(static_cast<uint8_t>(op));
+    }
+
+    void recordAll(Op op, const std::vector<int>& batch) {
+        keys.insert(keys.end(), batch.begin(), batch.end());
+        ops.insert(ops.end(), batch.size(), static_cast<uint8_t>(op));
+    }
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    void save(const std::string& path) const {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.byteOrder = kByteOrder;
+        header.count = keys.size();
+
+        size_t keyBytes = keys.size() * sizeof(int32_t);
+        std::vector<char> bytes(sizeof(Header) + keyBytes + ops.size());
+        std::memcpy(bytes.data(), &header, sizeof(Header));
+        if (!keys.empty()) {
+            std::memcpy(bytes.data() + sizeof(Header), keys.data(), keyBytes);
+            std::memcpy(bytes.data() + sizeof(Header) + keyBytes, ops.data(), ops.size());
+        }
+        writeFileAtomically(path, bytes);
+    }
+
+private:
+    std::vector<int32_t> keys;
+    std::vector<uint8_t> ops;
+};
+
+// Трасса, отображённая в память. verify = true проверяет все коды операций
+// (последовательный проход по 1 байту на запись), после чего op() всегда
+// возвращает допустимый Op
+class Reader {
+public:
+    explicit Reader(const std::string& path, bool verify = true) : file(path) {
+        if (file.size() < sizeof(Header)) {
+            throw fileError(path, "файл короче заголовка трассы");
+        }
+        const Header* header = reinterpret_cast<const Header*>(file.data());
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+            throw fileError(path, "не трасса нагрузки");
+        }
+        if (header->byteOrder != kByteOrder) {
+            throw fileError(path, "другой порядок байтов");
+        }
+        if (header->version != kVersion) {
+            throw fileError(path, "неподдерживаемая версия формата " + std::to_string(header->version));
+        }
+        count = static_cast<size_t>(header->count);
+        if (header->count > (file.size() - sizeof(Header)) / 5 ||
+            file.size() != sizeof(Header) + count * (sizeof(int32_t) + 1)) {
+            throw fileError(path, "размер файла не совпадает с числом записей");
+        }
+        keyData = reinterpret_cast<const int32_t*>(file.data() + sizeof(Header));
+        opData = reinterpret_cast<const uint8_t*>(keyData + count);
+        file.adviseSequential();
+        if (verify) {
+            for (size_t i = 0; i < count; ++i) {
+                if (opData[i] >= kOpCount) {
+                    throw fileError(path, "неизвестная операция в записи " + std::to_string(i));
+                }
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+    Op op(size_t i) const { return static_cast<Op>(opData[i]); }
+    int key(size_t i) const { return keyData[i]; }
+
+    // Ключи подряд, без копирования (например, для пакетных фаз)
+    const int32_t* keys() const { return keyData; }
+
+private:
+    MappedFile file;
+    size_t count;
+    const int32_t* keyData;
+    const uint8_t* opData;
+};
+
+// Ключи для демонстрационных прогонов (BST.cpp, AVL.cpp, RB.cpp). Без трассы
+// next() берёт ключ у генератора и запоминает его, а save() пишет трассу
+// вставок прогона. С трассой next() выдаёт её ключи по порядку (по кругу,
+// если прогон длиннее), так что прогон повторяется ключ в ключ
+class KeyStream {
+public:
+    // replayPath пуст — ключи даёт generate
+    KeyStream(const std::string& replayPath, std::function<int()> generate)
+        : generate(std::move(generate)), position(0) {
+        if (!replayPath.empty()) {
+            replay.reset(new Reader(replayPath));
+            if (replay->size() == 0) {
+                throw fileError(replayPath, "пустая трасса");
+            }
+        }
+    }
+
+    int next() {
+        if (replay) {
+            return replay->key(position++ % replay->size());
+        }
+        int key = generate();
+        recorded.record(INSERT, key);
+        return key;
+    }
+
+    // Трасса выданных ключей; при повторе писать нечего
+    void save(const std::string& path) const {
+        if (!replay) recorded.save(path);
+    }
+
+private:
+    std::function<int()> generate;
+    std::unique_ptr<Reader> replay;
+    Writer recorded;
+    size_t position;
+};
+
+} // namespace trace
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+// Двунаправленный итератор по узлам без указателя на родителя (BST и AVL).
+// Хранит путь от корня до текущего узла: ++ и -- поднимаются по нему,
+// поэтому каждый шаг в среднем O(1), а lowerBound/upperBound — один спуск.
+// Пустой путь означает end(); --end() переходит к максимуму.
+template <class Node>
+class PathIterator {
+public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int* pointer;
+    typedef const int& reference;
+
+    PathIterator() : root(nullptr) {}
+
+    // Итератор end() для дерева с корнем treeRoot
+    explicit PathIterator(Node* treeRoot) : root(treeRoot) {}
+
+    // Первый (наименьший) узел
+    static PathIterator first(Node* treeRoot) {
+        PathIterator it(treeRoot);
+        it.descendLeft(treeRoot);
+        return it;
+    }
+
+    // Первый узел со значением >= key
+    static PathIterator lowerBound(Node* treeRoot, int key) {
+        return bound(treeRoot, key, false);
+    }
+
+    // Первый узел со значением > key
+    static PathIterator upperBound(Node* treeRoot, int key) {
+        return bound(treeRoot, key, true);
+    }
+
+    reference operator*() const { return path.back()->value; }
+    pointer operator->() const { return &path.back()->value; }
+
+    // Текущий узел или nullptr для end()
+    Node* node() const { return path.empty() ? nullptr : path.back(); }
+
+    PathIterator& operator++() {
+        Node* current = path.back();
+        if (current->right) {
+            descendLeft(current->right);
+        }
+        else {
+            // Поднимаемся, пока приходим из правого поддерева
+            Node* child;
+            do {
+                child = path.back();
+                path.pop_back();
+            } while (!path.empty() && path.back()->right == child);
+        }
+        return *this;
+    }
+
+    PathIterator& operator--() {
+        if (path.empty()) {
+            descendRight(root);
+            return *this;
+        }
+        Node* current = path.back();
+        if (current->left) {
+            descendRight(current->left);
+        }
+        else {
+            Node* child;
+            do {
+                child = path.back();
+                path.pop_back();
+            } while (!path.empty() && path.back()->left == child);
+        }
+        return *this;
+    }
+
+    PathIterator operator++(int) {
+        PathIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    PathIterator operator--(int) {
+        PathIterator old = *this;
+        --*this;
+        return old;
+    }
+
+    bool operator==(const PathIterator& other) const { return node() == other.node(); }
+    bool operator!=(const PathIterator& other) const { return node() != other.node(); }
+
+private:
+    Node* root;
+    std::vector<Node*> path;
+
+    void descendLeft(Node* node) {
+        for (; node; node = node->left) path.push_back(node);
+    }
+
+    void descendRight(Node* node) {
+        for (; node; node = node->right) path.push_back(node);
+    }
+
+    // Спуск с запоминанием последнего подходящего узла; путь обрезается до него
+    static PathIterator bound(Node* treeRoot, int key, bool strict) {
+        PathIterator it(treeRoot);
+        size_t found = 0; // Длина пути до найденного узла, 0 — не найден
+        Node* current = treeRoot;
+        while (current) {
+            it.path.push_back(current);
+            if (strict ? current->value > key : current->value >= key) {
+                found = it.path.size();
+                current = current->left;
+            }
+            else {
+                current = current->right;
+            }
+        }
+        it.path.resize(found);
+        return it;
+    }
+};
+
+// Пара итераторов для range-for: for (int v : root->range(lo, hi)) ...
+template <class It>
+class IteratorRange {
+public:
+    IteratorRange(It b, It e) : first(b), last(e) {}
+
+    It begin() const { return first; }
+    It end() const { return last; }
+
+private:
+    It first;
+    It last;
+};
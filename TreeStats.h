@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef TREE_STATS
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace treestats {
+
+// Счётчики внутренней работы деревьев: повороты, перекраски и итерации
+// fixInsert / fixDelete красно-чёрного дерева, сравнения ключей и длины путей
+// поиска. Высота говорит, каким дерево стало; счётчики — сколько стоило его
+// таким держать, и их можно сопоставить с провалами пропускной способности.
+//
+// Включаются при сборке: -DTREE_STATS. Без него функции ниже пустые и inline,
+// и компилятор выбрасывает их вместе с аргументами — в обычной сборке
+// деревья те же до инструкции.
+//
+// Каждый поток считает в своих счётчиках, так что подсчёт не добавляет
+// разделяемых записей. snapshot() складывает счётчики всех потоков, в том
+// числе уже завершившихся (рабочие потоки шардов, параллельные ветви
+// split/join), а reset() запоминает текущие суммы как новый ноль. Снимать
+// их стоит, когда потоки фазы закончили работу или простаивают.
+
+enum Event {
+    ROTATIONS,              // Повороты AVL и красно-чёрного дерева
+    RECOLORS,               // Записи цвета в fixInsert / fixDelete
+    FIX_INSERT_ITERATIONS,  // Итерации цикла fixInsert
+    FIX_DELETE_ITERATIONS,  // Итерации цикла fixDelete
+    SEARCHES,
+    COMPARISONS             // Сравнения ключа при поиске (== и < считаются отдельно)
+};
+
+const int kEventCount = 6;
+
+const char* const kEventNames[] = {
+    "rotations", "recolors", "fix_insert_iterations", "fix_delete_iterations", "searches", "comparisons"
+};
+
+// Гистограмма длин путей поиска (в узлах); последняя корзина — kMaxPath и длиннее
+const int kMaxPath = 64;
+
+struct Counters {
+    uint64_t events[kEventCount];
+    uint64_t paths[kMaxPath + 1];
+
+    Counters() {
+        std::memset(this, 0, sizeof(*this));
+    }
+
+    uint64_t operator[](Event e) const { return events[e]; }
+
+    // Средняя длина пути поиска; 0, если поисков не было
+    double meanPath() const {
+        uint64_t total = 0;
+        uint64_t weighted = 0;
+        for (int i = 0; i <= kMaxPath; ++i) {
+            total += paths[i];
+            weighted += paths[i] * i;
+        }
+        return total ? static_cast<double>(weighted) / total : 0;
+    }
+
+    int maxPath() const {
+        for (int i = kMaxPath; i > 0; --i) {
+            if (paths[i]) return i;
+        }
+        return 0;
+    }
+};
+
+#ifdef TREE_STATS
+
+const bool kEnabled = true;
+
+// Счётчики одного потока. Пишет их только владелец (relaxed: обычное сложение),
+// читает snapshot() из любого потока
+struct ThreadCounters {
+    std::atomic<uint64_t> events[kEventCount];
+    std::atomic<uint64_t> paths[kMaxPath + 1];
+
+    ThreadCounters();
+    ~ThreadCounters();
+
+    void addTo(Counters& sum) const {
+        for (int i = 0; i < kEventCount; ++i) sum.events[i] += events[i].load(std::memory_order_relaxed);
+        for (int i = 0; i <= kMaxPath; ++i) sum.paths[i] += paths[i].load(std::memory_order_relaxed);
+    }
+};
+
+// Все потоки, которые что-то считали
+struct Registry {
+    std::mutex lock;
+    std::vector<const ThreadCounters*> live;
+    Counters finished;  // Сумма завершившихся потоков
+    Counters baseline;  // Суммы на момент reset()
+
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+
+    // Под lock
+    Counters total() const {
+        Counters sum = finished;
+        for (const ThreadCounters* t : live) t->addTo(sum);
+        return sum;
+    }
+};
+
+inline ThreadCounters::ThreadCounters() {
+    for (std::atomic<uint64_t>& e : events) e.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>& p : paths) p.store(0, std::memory_order_relaxed);
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.live.push_back(this);
+}
+
+inline ThreadCounters::~ThreadCounters() {
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    addTo(r.finished);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+}
+
+inline ThreadCounters& local() {
+    static thread_local ThreadCounters counters;
+    return counters;
+}
+
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void count(Event e, uint64_t n = 1) {
+    bump(local().events[e], n);
+}
+
+// Поиск закончился: descended — сколько раз спустились к потомку (на каждом
+// шаге два сравнения, == и <), found — совпал ли последний узел (ещё одно ==)
+inline void searched(int descended, bool found) {
+    ThreadCounters& c = local();
+    int path = descended + (found ? 1 : 0);
+    bump(c.events[SEARCHES], 1);
+    bump(c.events[COMPARISONS], 2 * static_cast<uint64_t>(descended) + (found ? 1 : 0));
+    bump(c.paths[path < kMaxPath ? path : kMaxPath], 1);
+}
+
+// Счётчики всех потоков с последнего reset()
+inline Counters snapshot() {
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    Counters sum = r.total();
+    for (int i = 0; i < kEventCount; ++i) sum.events[i] -= r.baseline.events[i];
+    for (int i = 0; i <= kMaxPath; ++i) sum.paths[i] -= r.baseline.paths[i];
+    return sum;
+}
+
+inline void reset() {
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.baseline = r.total();
+}
+
+#else
+
+const bool kEnabled = false;
+
+inline void count(Event, uint64_t = 1) {}
+inline void searched(int, bool) {}
+inline Counters snapshot() { return Counters(); }
+inline void reset() {}
+
+#endif
+
+} // namespace treestats
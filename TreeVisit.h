@@ -0,0 +1,133 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Обходы деревьев с посетителем: visit(node) вызывается для каждого узла
+// и встраивается компилятором, а вывода при обходе нет вовсе. Обходы
+// итеративные (вырожденное BST может иметь глубину n). nil — фиктивный
+// лист (TNULL у красно-чёрного дерева), для BST и AVL это nullptr.
+
+template <class Node, class Visitor>
+void visitPreorder(Node* root, Visitor&& visit, const Node* nil = nullptr) {
+    std::vector<Node*> stack;
+    if (root != nil) stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+        visit(node);
+        if (node->right != nil) stack.push_back(node->right);
+        if (node->left != nil) stack.push_back(node->left);
+    }
+}
+
+template <class Node, class Visitor>
+void visitInorder(Node* root, Visitor&& visit, const Node* nil = nullptr) {
+    std::vector<Node*> stack;
+    Node* current = root;
+    while (current != nil || !stack.empty()) {
+        while (current != nil) {
+            stack.push_back(current);
+            current = current->left;
+        }
+        current = stack.back();
+        stack.pop_back();
+        visit(current);
+        current = current->right;
+    }
+}
+
+template <class Node, class Visitor>
+void visitPostorder(Node* root, Visitor&& visit, const Node* nil = nullptr) {
+    std::vector<Node*> stack;
+    Node* current = root;
+    Node* last = nullptr; // Последний посещённый узел
+    while (current != nil || !stack.empty()) {
+        while (current != nil) {
+            stack.push_back(current);
+            current = current->left;
+        }
+        Node* top = stack.back();
+        if (top->right != nil && top->right != last) {
+            // Правое поддерево ещё не обойдено
+            current = top->right;
+        }
+        else {
+            visit(top);
+            last = top;
+            stack.pop_back();
+        }
+    }
+}
+
+// Обход в ширину: очередь — вектор с индексом головы, без выделений на каждый узел
+template <class Node, class Visitor>
+void visitLevelOrder(Node* root, Visitor&& visit, const Node* nil = nullptr) {
+    std::vector<Node*> queue;
+    if (root != nil) queue.push_back(root);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        Node* node = queue[head];
+        visit(node);
+        if (node->left != nil) queue.push_back(node->left);
+        if (node->right != nil) queue.push_back(node->right);
+    }
+}
+
+// Буферизованный вывод: текст копится в буфере и уходит в поток крупными
+// кусками через write(), без сброса на каждой строке, как у std::endl
+class BufferedWriter {
+public:
+    explicit BufferedWriter(std::ostream& stream, size_t capacity = 1 << 16)
+        : out(stream), buffer(capacity < 32 ? 32 : capacity), used(0) {}
+
+    ~BufferedWriter() { flush(); }
+
+    BufferedWriter& operator<<(const char* s) {
+        for (; *s; ++s) put(*s);
+        return *this;
+    }
+
+    BufferedWriter& operator<<(char c) {
+        put(c);
+        return *this;
+    }
+
+    BufferedWriter& operator<<(int v) {
+        if (buffer.size() - used < 16) flush();
+        std::to_chars_result r = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), v);
+        used = static_cast<size_t>(r.ptr - buffer.data());
+        return *this;
+    }
+
+    void flush() {
+        out.write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+    }
+
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used;
+
+    void put(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+};
+
+// Посетитель-печать: node->print(out) для каждого узла
+template <class Node>
+class PrintVisitor {
+public:
+    explicit PrintVisitor(BufferedWriter& writer) : out(writer) {}
+
+    void operator()(const Node* node) const { node->print(out); }
+
+private:
+    BufferedWriter& out;
+};
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+namespace workload {
+
+// Генератор нагрузки в духе YCSB: быстрый 64-битный ГПСЧ, распределения
+// ключей и смесь операций чтения, вставки, удаления и сканирования.
+// Равномерные ключи rand() % N прячут как раз те случаи, где деревья
+// различаются: отсортированный поток вырождает BST в список, горячие ключи
+// Zipf держат верх дерева в кэше, а «свежие» ключи бьют в одну ветку.
+//
+// Распределения:
+//   uniform   — равномерно по [0, keyRange);
+//   zipfian   — вставки равномерные, запросы к вставленным ключам по Zipf
+//               (theta = 0.99, как в YCSB); горячие ключи разбросаны по
+//               диапазону хешем, а не собраны в его начале;
+//   latest    — вставки равномерные, запросы по Zipf от самых свежих вставок;
+//   sorted    — 0, 1, 2, ... (по кругу в пределах диапазона);
+//   reverse   — keyRange - 1, keyRange - 2, ...;
+//   sawtooth  — зубья пилы: каждый зуб — возрастающий проход по всему
+//               диапазону с шагом, следующий зуб сдвинут на 1;
+//   clustered — несколько плотных полос в случайных местах диапазона
+//               (вместе — четверть диапазона).
+// Последние четыре задают порядок ключей вставки; запросы для них равномерны
+// по вставленным ключам.
+
+enum Distribution { UNIFORM, ZIPFIAN, LATEST, SORTED, REVERSE, SAWTOOTH, CLUSTERED };
+
+const char* const kDistributionNames[] = {
+    "uniform", "zipfian", "latest", "sorted", "reverse", "sawtooth", "clustered"
+};
+const int kDistributionCount = 7;
+
+inline const char* distributionName(Distribution d) {
+    return kDistributionNames[d];
+}
+
+// false, если имя неизвестно
+inline bool parseDistribution(const std::string& name, Distribution& d) {
+    for (int i = 0; i < kDistributionCount; ++i) {
+        if (name == kDistributionNames[i]) {
+            d = static_cast<Distribution>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Перемешивание 64-битного слова (финализатор splitmix64): из соседних
+// значений получаются независимые на вид
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** (Blackman, Vigna): четыре сдвига, поворот и умножение на число —
+// в разы быстрее mt19937_64 и без его 2.5 КБ состояния. Годится как URBG
+// для std::shuffle и распределений <random>
+class Random {
+public:
+    typedef uint64_t result_type;
+
+    explicit Random(uint64_t seed = 1) {
+        // Состояние заполняет splitmix64: нулевое зерно тоже даёт ненулевое состояние
+        for (uint64_t& word : s) {
+            seed += 0x9e3779b97f4a7c15ull;
+            word = mix64(seed);
+        }
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Равномерно в [0, n), n > 0: умножение со сдвигом вместо деления,
+    // редкие отбрасывания убирают смещение (Lemire, 2019)
+    uint64_t below(uint64_t n) {
+        unsigned __int128 m = static_cast<unsigned __int128>((*this)()) * n;
+        uint64_t low = static_cast<uint64_t>(m);
+        if (low < n) {
+            uint64_t threshold = (0 - n) % n;
+            while (low < threshold) {
+                m = static_cast<unsigned __int128>((*this)()) * n;
+                low = static_cast<uint64_t>(m);
+            }
+        }
+        return static_cast<uint64_t>(m >> 64);
+    }
+
+    // Равномерно в [0, 1)
+    double unit() {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// Zipf по рангам [0, n): ранг 0 самый частый, вероятность ранга i
+// пропорциональна 1 / (i + 1)^theta, 0 < theta < 1. Метод Gray и др. (1994),
+// как в YCSB: одно pow на выборку. Нормирующая сумма zeta(n) точна до 2^20
+// слагаемых, дальше хвост берётся интегралом по средним точкам (ошибка
+// меньше 10^-6 от суммы); grow() досчитывает её при росте n
+class Zipfian {
+public:
+    explicit Zipfian(uint64_t n = 1, double theta = 0.99)
+        : items(0), theta(theta), alpha(1.0 / (1.0 - theta)), zetan(0) {
+        zeta2 = 1.0 + std::pow(0.5, theta);
+        half = std::pow(0.5, theta);
+        grow(n < 1 ? 1 : n);
+    }
+
+    uint64_t size() const { return items; }
+
+    // Расширяет ранги до [0, n); уменьшать нельзя
+    void grow(uint64_t n) {
+        if (n <= items) {
+            return;
+        }
+        if (items < kExactTerms && n > kExactTerms) {
+            zetan += partialZeta(items, kExactTerms);
+            items = kExactTerms;
+        }
+        if (n > kExactTerms) {
+            // Хвост суммы: ∑ i^-theta по i из (items, n] ≈ ∫ x^-theta dx по [items + 0.5, n + 0.5]
+            double e = 1.0 - theta;
+            zetan += (std::pow(n + 0.5, e) - std::pow(items + 0.5, e)) / e;
+        }
+        else {
+            zetan += partialZeta(items, n);
+        }
+        items = n;
+        eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    uint64_t next(Random& rng) const {
+        double u = rng.unit();
+        double uz = u * zetan;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + half) {
+            return 1;
+        }
+        uint64_t rank = static_cast<uint64_t>(items * std::pow(eta * u - eta + 1.0, alpha));
+        return rank < items ? rank : items - 1;
+    }
+
+private:
+    static const uint64_t kExactTerms = 1 << 20;
+
+    uint64_t items;
+    double theta;
+    double alpha;
+    double zetan;
+    double zeta2;
+    double half;
+    double eta;
+
+    // ∑ 1 / i^theta по i из (from, to]
+    double partialZeta(uint64_t from, uint64_t to) const {
+        double sum = 0;
+        for (uint64_t i = from + 1; i <= to; ++i) sum += std::pow(static_cast<double>(i), -theta);
+        return sum;
+    }
+};
+
+struct Spec {
+    Distribution distribution = UNIFORM;
+    int keyRange = 1000000;  // Ключи из [0, keyRange)
+    double theta = 0.99;     // Перекос zipfian и latest
+    int period = 1000;       // Длина зуба sawtooth
+    int clusters = 8;        // Число полос clustered
+    uint64_t seed = 1;
+};
+
+// Поток ключей вставки по распределению Spec
+class KeyGenerator {
+public:
+    explicit KeyGenerator(const Spec& spec) : spec(spec), rng(spec.seed), position(0), width(1) {
+        if (spec.keyRange <= 0) {
+            throw std::invalid_argument("keyRange должно быть положительным");
+        }
+        uint64_t range = static_cast<uint64_t>(spec.keyRange);
+        if (spec.distribution == CLUSTERED) {
+            int count = spec.clusters > 0 ? spec.clusters : 1;
+            width = range / (4 * static_cast<uint64_t>(count));
+            if (width == 0) width = 1;
+            for (int i = 0; i < count; ++i) starts.push_back(rng.below(range - width + 1));
+        }
+        period = spec.period > 0 ? static_cast<uint64_t>(spec.period) : 1;
+        step = range / period;
+        if (step == 0) step = 1;
+    }
+
+    int next() {
+        uint64_t range = static_cast<uint64_t>(spec.keyRange);
+        uint64_t i = position++;
+        uint64_t key;
+        switch (spec.distribution) {
+        case SORTED:
+            key = i % range;
+            break;
+        case REVERSE:
+            key = range - 1 - i % range;
+            break;
+        case SAWTOOTH:
+            key = ((i % period) * step + (i / period) % step) % range;
+            break;
+        case CLUSTERED:
+            key = starts[rng.below(starts.size())] + rng.below(width);
+            break;
+        default:
+            key = rng.below(range);
+            break;
+        }
+        return static_cast<int>(key);
+    }
+
+    std::vector<int> take(size_t count) {
+        std::vector<int> keys(count);
+        for (int& k : keys) k = next();
+        return keys;
+    }
+
+private:
+    Spec spec;
+    Random rng;
+    uint64_t position;
+    uint64_t period;
+    uint64_t step;
+    uint64_t width;
+    std::vector<uint64_t> starts;
+};
+
+// Выбор ключей запросов среди вставленных: zipfian — по популярности,
+// latest — по свежести, остальные — равномерно
+class RequestChooser {
+public:
+    RequestChooser(const Spec& spec, uint64_t seed)
+        : distribution(spec.distribution), rng(seed), zipf(1, spec.theta) {}
+
+    // inserted не пуст; ключи идут в порядке вставки
+    int choose(const std::vector<int>& inserted) {
+        uint64_t n = inserted.size();
+        if (distribution == ZIPFIAN || distribution == LATEST) {
+            zipf.grow(n);
+            uint64_t rank = zipf.next(rng) % n; // Ранг за n, если раньше выбирали из вектора длиннее
+            if (distribution == LATEST) {
+                return inserted[n - 1 - rank];
+            }
+            // Без хеша горячими были бы первые вставленные ключи
+            return inserted[mix64(rank) % n];
+        }
+        return inserted[rng.below(n)];
+    }
+
+private:
+    Distribution distribution;
+    Random rng;
+    Zipfian zipf;
+};
+
+// Доли операций; нормировать не нужно, важны отношения
+struct Mix {
+    double read = 50;
+    double insert = 50;
+    double remove = 0;
+    double scan = 0;
+};
+
+// "R:I:D:S" — доли чтения, вставки, удаления и сканирования, например
+// "95:5:0:0" (YCSB B) или "0:5:0:95" (YCSB E). false при ошибке разбора
+inline bool parseMix(const std::string& text, Mix& mix) {
+    double parts[4];
+    const char* p = text.c_str();
+    for (int i = 0; i < 4; ++i) {
+        char* end = nullptr;
+        parts[i] = std::strtod(p, &end);
+        if (end == p || parts[i] < 0) {
+            return false;
+        }
+        if (i < 3 && *end != ':') {
+            return false;
+        }
+        if (i == 3 && *end != '\0') {
+            return false;
+        }
+        p = end + 1;
+    }
+    if (parts[0] + parts[1] + parts[2] + parts[3] <= 0) {
+        return false;
+    }
+    mix.read = parts[0];
+    mix.insert = parts[1];
+    mix.remove = parts[2];
+    mix.scan = parts[3];
+    return true;
+}
+
+struct Operation {
+    trace::Op op;
+    int key;    // Для SCAN — начало диапазона
+};
+
+// Поток операций смеси Mix. Вставки берут ключи у KeyGenerator, чтения,
+// удаления и сканы — у RequestChooser среди уже вставленных ключей.
+// Удалённые ключи из истории не вычёркиваются: повторный запрос к ним —
+// промах, как и в реальной нагрузке
+class OperationGenerator {
+public:
+    OperationGenerator(const Spec& spec, const Mix& mix)
+        : keys(spec), requests(spec, mix64(spec.seed) + 1), rng(mix64(spec.seed + 1)) {
+        double total = mix.read + mix.insert + mix.remove + mix.scan;
+        readBelow = mix.read / total;
+        insertBelow = readBelow + mix.insert / total;
+        removeBelow = insertBelow + mix.remove / total;
+    }
+
+    // Ключи фазы загрузки, уже лежащие в дереве: первые loaded.size() ключей
+    // KeyGenerator с тем же Spec. Вставки смеси продолжают поток после них
+    void load(const std::vector<int>& loaded) {
+        inserted.insert(inserted.end(), loaded.begin(), loaded.end());
+        for (size_t i = 0; i < loaded.size(); ++i) keys.next();
+    }
+
+    Operation next() {
+        double u = rng.unit();
+        Operation o;
+        if (u >= readBelow && u < insertBelow) {
+            o.op = trace::INSERT;
+        }
+        else if (inserted.empty()) {
+            o.op = trace::INSERT; // Запрашивать ещё нечего
+        }
+        else {
+            o.op = u < readBelow ? trace::SEARCH : u < removeBelow ? trace::REMOVE : trace::SCAN;
+        }
+        if (o.op == trace::INSERT) {
+            o.key = keys.next();
+            inserted.push_back(o.key);
+        }
+        else {
+            o.key = requests.choose(inserted);
+        }
+        return o;
+    }
+
+    std::vector<Operation> take(size_t count) {
+        std::vector<Operation> ops(count);
+        for (Operation& o : ops) o = next();
+        return ops;
+    }
+
+private:
+    KeyGenerator keys;
+    RequestChooser requests;
+    Random rng;
+    std::vector<int> inserted;
+    double readBelow;
+    double insertBelow;
+    double removeBelow;
+};
+
+} // namespace workload